@@ -0,0 +1,18 @@
+/**
+* \file
+* \brief Host stand-in for <avr/interrupt.h>
+* \details ISR() defines the handler under the name that <avr/io.h> maps the vector to. hal.c calls
+*   it when the interrupt is pending, enabled, and the global interrupt flag is set.
+**/
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include "hal.h"
+
+#define ISR(vector, ...)    void vector(void); void vector(void)
+
+#define sei()   host_sei()
+#define cli()   host_cli()
+
+#endif
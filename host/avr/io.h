@@ -0,0 +1,296 @@
+/**
+* \file
+* \brief Host stand-in for <avr/io.h>
+*
+* Declares the XMEGA E peripherals that uart_io.c uses. The registers are backed by the emulation
+* in hal.c.
+*
+* Every register field name is a macro that calls into the emulator right before the access. This
+* gives the emulator a chance to advance time, deliver interrupts and find out what the previous
+* access did. Fields are stored as 32-bit words. The emulator puts HOST_REG_TAG in the upper half
+* so that a plain write is recognized even if it stores the value that was already there.
+*
+* Only include this after all system headers, since field names such as \c DATA and \c IN become
+* macros.
+**/
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#include "hal.h"
+
+typedef volatile uint32_t host_reg_t;
+
+//==================================================================================================
+// Register Access Hooks
+//==================================================================================================
+///\cond INTERNAL
+#define HOST_REG(name)  name##_[host_reg_access()]
+
+#define DATA        DATA_[host_data_access()]
+#define STATUS      HOST_REG(STATUS)
+#define CTRL        HOST_REG(CTRL)
+#define CTRLA       HOST_REG(CTRLA)
+#define CTRLB       HOST_REG(CTRLB)
+#define CTRLC       HOST_REG(CTRLC)
+#define CTRLD       HOST_REG(CTRLD)
+#define BAUDCTRLA   HOST_REG(BAUDCTRLA)
+#define BAUDCTRLB   HOST_REG(BAUDCTRLB)
+#define INTFLAGS    HOST_REG(INTFLAGS)
+#define TEMP        HOST_REG(TEMP)
+#define ADDRCTRL    HOST_REG(ADDRCTRL)
+#define TRIGSRC     HOST_REG(TRIGSRC)
+#define TRFCNT      HOST_REG(TRFCNT)
+#define TRFCNTL     HOST_REG(TRFCNTL)
+#define TRFCNTH     HOST_REG(TRFCNTH)
+#define ADDRL       HOST_REG(ADDRL)
+#define ADDRH       HOST_REG(ADDRH)
+#define DIR         HOST_REG(DIR)
+#define DIRSET      HOST_REG(DIRSET)
+#define DIRCLR      HOST_REG(DIRCLR)
+#define DIRTGL      HOST_REG(DIRTGL)
+#define OUT         HOST_REG(OUT)
+#define OUTSET      HOST_REG(OUTSET)
+#define OUTCLR      HOST_REG(OUTCLR)
+#define OUTTGL      HOST_REG(OUTTGL)
+#define IN          HOST_REG(IN)
+#define INTCTRL     HOST_REG(INTCTRL)
+#define INT0MASK    HOST_REG(INT0MASK)
+#define INT1MASK    HOST_REG(INT1MASK)
+#define PIN0CTRL    HOST_REG(PIN0CTRL)
+#define PIN1CTRL    HOST_REG(PIN1CTRL)
+#define PIN2CTRL    HOST_REG(PIN2CTRL)
+#define PIN3CTRL    HOST_REG(PIN3CTRL)
+#define PIN4CTRL    HOST_REG(PIN4CTRL)
+#define PIN5CTRL    HOST_REG(PIN5CTRL)
+#define PIN6CTRL    HOST_REG(PIN6CTRL)
+#define PIN7CTRL    HOST_REG(PIN7CTRL)
+///\endcond
+
+//==================================================================================================
+// Peripherals
+//==================================================================================================
+
+typedef struct USART_struct{
+    host_reg_t DATA_[1];
+    host_reg_t STATUS_[1];
+    host_reg_t CTRLA_[1];
+    host_reg_t CTRLB_[1];
+    host_reg_t CTRLC_[1];
+    host_reg_t CTRLD_[1];
+    host_reg_t BAUDCTRLA_[1];
+    host_reg_t BAUDCTRLB_[1];
+}USART_t;
+
+typedef struct PORT_struct{
+    host_reg_t DIR_[1];
+    host_reg_t DIRSET_[1];
+    host_reg_t DIRCLR_[1];
+    host_reg_t DIRTGL_[1];
+    host_reg_t OUT_[1];
+    host_reg_t OUTSET_[1];
+    host_reg_t OUTCLR_[1];
+    host_reg_t OUTTGL_[1];
+    host_reg_t IN_[1];
+    host_reg_t INTCTRL_[1];
+    host_reg_t INT0MASK_[1];
+    host_reg_t INT1MASK_[1];
+    host_reg_t INTFLAGS_[1];
+    host_reg_t PIN0CTRL_[1]; // PINnCTRL must stay contiguous. uart_io.c indexes from PIN0CTRL
+    host_reg_t PIN1CTRL_[1];
+    host_reg_t PIN2CTRL_[1];
+    host_reg_t PIN3CTRL_[1];
+    host_reg_t PIN4CTRL_[1];
+    host_reg_t PIN5CTRL_[1];
+    host_reg_t PIN6CTRL_[1];
+    host_reg_t PIN7CTRL_[1];
+}PORT_t;
+
+typedef struct EDMA_CH_struct{
+    host_reg_t CTRLA_[1];
+    host_reg_t CTRLB_[1];
+    host_reg_t ADDRCTRL_[1];
+    host_reg_t TRIGSRC_[1];
+    host_reg_t TRFCNT_[1];
+    host_reg_t TRFCNTL_[1];
+    host_reg_t TRFCNTH_[1];
+    host_reg_t ADDRL_[1];
+    host_reg_t ADDRH_[1];
+}EDMA_CH_t;
+
+typedef struct EDMA_struct{
+    host_reg_t CTRL_[1];
+    host_reg_t INTFLAGS_[1];
+    host_reg_t STATUS_[1];
+    host_reg_t TEMP_[1];
+    EDMA_CH_t CH0;
+    EDMA_CH_t CH1;
+    EDMA_CH_t CH2;
+    EDMA_CH_t CH3;
+}EDMA_t;
+
+extern USART_t USARTD0;
+extern PORT_t PORTA;
+extern PORT_t PORTD;
+extern EDMA_t EDMA;
+
+//==================================================================================================
+// Interrupt Vectors
+//==================================================================================================
+#define PORTA_INT0_vect     host_vect_porta_int0
+#define PORTA_INT1_vect     host_vect_porta_int1
+#define PORTD_INT0_vect     host_vect_portd_int0
+#define PORTD_INT1_vect     host_vect_portd_int1
+#define EDMA_CH0_vect       host_vect_edma_ch0
+#define EDMA_CH1_vect       host_vect_edma_ch1
+#define EDMA_CH2_vect       host_vect_edma_ch2
+#define EDMA_CH3_vect       host_vect_edma_ch3
+#define USARTD0_RXC_vect    host_vect_usartd0_rxc
+#define USARTD0_DRE_vect    host_vect_usartd0_dre
+#define USARTD0_TXC_vect    host_vect_usartd0_txc
+
+//==================================================================================================
+// Bit Definitions
+//==================================================================================================
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+
+// USART.STATUS
+#define USART_RXCIF_bm  0x80
+#define USART_TXCIF_bm  0x40
+#define USART_DREIF_bm  0x20
+#define USART_FERR_bm   0x10
+#define USART_BUFOVF_bm 0x08
+#define USART_PERR_bm   0x04
+#define USART_RXB8_bm   0x01
+
+// USART.CTRLA
+#define USART_RXCINTLVL_gm      0x30
+#define USART_RXCINTLVL_gp      4
+#define USART_RXCINTLVL_OFF_gc  0x00
+#define USART_RXCINTLVL_LO_gc   0x10
+#define USART_RXCINTLVL_MED_gc  0x20
+#define USART_RXCINTLVL_HI_gc   0x30
+#define USART_TXCINTLVL_gm      0x0C
+#define USART_TXCINTLVL_gp      2
+#define USART_TXCINTLVL_OFF_gc  0x00
+#define USART_TXCINTLVL_LO_gc   0x04
+#define USART_TXCINTLVL_MED_gc  0x08
+#define USART_TXCINTLVL_HI_gc   0x0C
+#define USART_DREINTLVL_gm      0x03
+#define USART_DREINTLVL_gp      0
+#define USART_DREINTLVL_OFF_gc  0x00
+#define USART_DREINTLVL_LO_gc   0x01
+#define USART_DREINTLVL_MED_gc  0x02
+#define USART_DREINTLVL_HI_gc   0x03
+
+// USART.CTRLB
+#define USART_RXEN_bm   0x10
+#define USART_TXEN_bm   0x08
+#define USART_CLK2X_bm  0x04
+#define USART_MPCM_bm   0x02
+#define USART_TXB8_bm   0x01
+
+// USART.CTRLC
+#define USART_CMODE_gm          0xC0
+#define USART_CMODE_MSPI_gc     0xC0
+#define USART_PMODE_gm          0x30
+#define USART_SBMODE_bm         0x08
+#define USART_CHSIZE_gm         0x07
+#define USART_CHSIZE_5BIT_gc    0x00
+#define USART_CHSIZE_6BIT_gc    0x01
+#define USART_CHSIZE_7BIT_gc    0x02
+#define USART_CHSIZE_8BIT_gc    0x03
+#define USART_CHSIZE_9BIT_gc    0x07
+
+// USART.BAUDCTRLB
+#define USART_BSCALE_gm 0xF0
+#define USART_BSCALE_gp 4
+
+// EDMA.CTRL
+#define EDMA_ENABLE_bm              0x80
+#define EDMA_RESET_bm               0x40
+#define EDMA_CHMODE_gm              0x30
+#define EDMA_CHMODE_PER0123_gc      0x00
+#define EDMA_CHMODE_STD02_gc        0x30
+#define EDMA_DBUFMODE_gm            0x0C
+#define EDMA_DBUFMODE_DISABLE_gc    0x00
+#define EDMA_DBUFMODE_BUF0123_gc    0x0C
+
+// EDMA.CHn.CTRLA
+#define EDMA_CH_ENABLE_bm   0x80
+#define EDMA_CH_RESET_bm    0x40
+#define EDMA_CH_REPEAT_bm   0x20
+#define EDMA_CH_TRFREQ_bm   0x10
+#define EDMA_CH_SINGLE_bm   0x04
+#define EDMA_CH_BURSTLEN_bm 0x01
+
+// EDMA.CHn.CTRLB
+#define EDMA_CH_CHBUSY_bm       0x80
+#define EDMA_CH_CHPEND_bm       0x40
+#define EDMA_CH_ERRIF_bm        0x20
+#define EDMA_CH_TRNIF_bm        0x10
+#define EDMA_CH_ERRINTLVL_gm    0x0C
+#define EDMA_CH_ERRINTLVL_gp    2
+#define EDMA_CH_TRNINTLVL_gm    0x03
+#define EDMA_CH_TRNINTLVL_gp    0
+#define EDMA_CH_TRNINTLVL0_bm   0x01
+#define EDMA_CH_TRNINTLVL1_bm   0x02
+
+// EDMA.CHn.ADDRCTRL
+#define EDMA_CH_RELOAD_gm               0x30
+#define EDMA_CH_RELOAD_NONE_gc          0x00
+#define EDMA_CH_RELOAD_BLOCK_gc         0x10
+#define EDMA_CH_RELOAD_BURST_gc         0x20
+#define EDMA_CH_RELOAD_TRANSACTION_gc   0x30
+#define EDMA_CH_DIR_gm                  0x03
+#define EDMA_CH_DIR_FIXED_gc            0x00
+#define EDMA_CH_DIR_INC_gc              0x01
+#define EDMA_CH_DIR_DEC_gc              0x02
+
+// EDMA.CHn.TRIGSRC
+#define EDMA_CH_TRIGSRC_OFF_gc          0x00
+#define EDMA_CH_TRIGSRC_USARTD0_RXC_gc  0x6B
+#define EDMA_CH_TRIGSRC_USARTD0_DRE_gc  0x6C
+
+// PORT.INTCTRL
+#define PORT_INT1LVL_gm     0x0C
+#define PORT_INT1LVL_gp     2
+#define PORT_INT1LVL_LO_gc  0x04
+#define PORT_INT1LVL_MED_gc 0x08
+#define PORT_INT1LVL_HI_gc  0x0C
+#define PORT_INT0LVL_gm     0x03
+#define PORT_INT0LVL_gp     0
+#define PORT_INT0LVL_LO_gc  0x01
+#define PORT_INT0LVL_MED_gc 0x02
+#define PORT_INT0LVL_HI_gc  0x03
+
+// PORT.INTFLAGS
+#define PORT_INT1IF_bm  0x02
+#define PORT_INT0IF_bm  0x01
+#define VPORT_INT1IF_bm 0x02
+#define VPORT_INT0IF_bm 0x01
+
+// PORT.PINnCTRL
+#define PORT_ISC_gm             0x07
+#define PORT_ISC_BOTHEDGES_gc   0x00
+#define PORT_ISC_RISING_gc      0x01
+#define PORT_ISC_FALLING_gc     0x02
+#define PORT_ISC_LEVEL_gc       0x03
+#define PORT_ISC_INPUT_DISABLE_gc 0x07
+
+//==================================================================================================
+// CPU
+//==================================================================================================
+#define CPU_I_bm    0x80
+#define SREG        host_sreg
+
+#endif
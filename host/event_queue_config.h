@@ -0,0 +1,12 @@
+/**
+* \file
+* \brief event_queue configuration for the host build
+**/
+
+#ifndef EVENT_QUEUE_CONFIG_H
+#define EVENT_QUEUE_CONFIG_H
+
+#define EVENT_QUEUE_SIZE    128
+#define MAX_YIELD_DEPTH     2
+
+#endif
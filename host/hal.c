@@ -0,0 +1,1212 @@
+/**
+* \file
+* \brief Host emulation of the XMEGA USART, EDMA and PORT registers used by uart_io.c
+*
+* The register fields in <avr/io.h> call host_reg_access() or host_data_access() right before each
+* access. Each call:
+* - Commits the previous access. Every field holds HOST_REG_TAG plus the register's value. A plain
+*   write clears the tag. A read-modify-write keeps it but changes the value. Either way, the new
+*   value is applied to the emulated peripheral as a register write.
+* - Charges the CPU cycles of the access to the emulated clock.
+* - Advances the peripherals to the new time. Events are processed in order, and pending
+*   interrupts are delivered after each one, as if the CPU had been running in between.
+* - Re-arms the fields with the current register values.
+*
+* The emulated clock only moves with the CPU: every register access and every change of the
+* interrupt flag costs host_config::access_cycles, and every interrupt host_config::isr_cycles. Runs
+* with the same input therefore give the same result, however the host schedules the process. All
+* waiting loops in uart_io.c access registers or enter critical sections, so they keep the clock
+* moving.
+*
+* A DATA access pops the receive buffer right away and arms DATA with the popped character. If
+* the access turns out to be a write, the character is pushed back and the write is transmitted.
+*
+* Interrupt handlers access registers too. While the emulator is running a handler, their accesses
+* are committed and charged, but events are only processed once the handler returns.
+**/
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#undef CTRL // <termios.h> defines CTRL(x), which is a register name in <avr/io.h>
+
+#include <avr/io.h>
+
+#include "hal.h"
+
+//==================================================================================================
+// Registers
+//==================================================================================================
+
+USART_t USARTD0;
+PORT_t PORTA;
+PORT_t PORTD;
+EDMA_t EDMA;
+
+volatile uint8_t host_sreg;
+
+// Handlers are only defined if the driver's configuration uses them
+void PORTA_INT0_vect(void) __attribute__ ((weak));
+void PORTA_INT1_vect(void) __attribute__ ((weak));
+void PORTD_INT0_vect(void) __attribute__ ((weak));
+void PORTD_INT1_vect(void) __attribute__ ((weak));
+void EDMA_CH0_vect(void) __attribute__ ((weak));
+void EDMA_CH1_vect(void) __attribute__ ((weak));
+void EDMA_CH2_vect(void) __attribute__ ((weak));
+void EDMA_CH3_vect(void) __attribute__ ((weak));
+void USARTD0_RXC_vect(void) __attribute__ ((weak));
+void USARTD0_DRE_vect(void) __attribute__ ((weak));
+void USARTD0_TXC_vect(void) __attribute__ ((weak));
+
+// Start of the memory that the EDMA's 16-bit addresses refer to
+static uint8_t DMA_Base[1] HOST_DMA_MEM __attribute__ ((aligned (65536)));
+
+#define SRC_SIZE    65536   // Characters waiting to be sent to the USART
+#define SINK_SIZE   65536   // Transmitted characters waiting for host_tx_read()
+#define USART_TXPIN PIN3_bm // TXD0 of USARTD0 is PD3
+
+//==================================================================================================
+// Emulator State
+//==================================================================================================
+
+static struct host_config Cfg;
+static struct host_stats Stats;
+
+static uint64_t Clock; // Emulated time in ns
+static uint64_t Clock_frac; // Fraction of a ns on top of Clock, in units of 1/f_cpu ns
+static uint64_t Cursor; // Emulated time that the peripherals have reached
+
+static int Depth; // Non-zero while the emulator is running
+static bool In_isr;
+
+static struct{
+    uint8_t ctrla;
+    uint8_t ctrlb;
+    uint8_t ctrlc;
+    uint8_t ctrld;
+    uint8_t baudctrla;
+    uint8_t baudctrlb;
+
+    // Receive buffer. 2 characters, plus 1 while a DATA write is waiting to give back its pop
+    uint8_t rx_data[3];
+    uint8_t rx_flags[3]; // FERR, BUFOVF and PERR of each character
+    uint8_t rx_count;
+    uint8_t last_data;
+
+    bool txcif;
+    bool tx_buf_full;
+    uint8_t tx_buf;
+    bool tx_busy; // Shift register is sending tx_shift
+    uint8_t tx_shift;
+    uint64_t tx_done;
+    bool tx_disabling; // TXEN was cleared while transmitting
+    bool tx_undriven; // DE was low during part of the character being sent
+    uint64_t tx_idle_at; // Time the transmitter last went idle
+
+    uint64_t frame_ns;
+} Usart;
+
+// Pending DATA access of the CPU [0] and of an ISR [1]
+static struct{
+    bool pending;
+    bool popped;
+    uint8_t data;
+    uint8_t flags;
+} Data_access[2];
+
+struct dma_ch{
+    EDMA_CH_t *regs;
+    void (*vect)(void);
+    uint8_t ctrla;
+    uint8_t ctrlb;
+    uint8_t addrctrl;
+    uint8_t trigsrc;
+    uint16_t trfcnt;
+    uint16_t trfcnt_reload;
+    uint16_t addr;
+    uint16_t addr_reload;
+};
+
+static uint8_t Edma_ctrl;
+static struct dma_ch Dma[4];
+
+struct port{
+    PORT_t *regs;
+    void (*vect_int0)(void);
+    void (*vect_int1)(void);
+    uint8_t dir;
+    uint8_t out;
+    uint8_t ext; // Level driven onto the pins from outside
+    uint8_t in;
+    uint8_t intctrl;
+    uint8_t int0mask;
+    uint8_t int1mask;
+    uint8_t intflags;
+    uint8_t pinctrl[8];
+};
+
+static struct port Port[2];
+
+// Sender at the other end of the line
+static struct{
+    uint8_t buf[SRC_SIZE];
+    size_t rdidx;
+    size_t count;
+    bool busy;
+    uint8_t data;
+    uint64_t done;
+    uint8_t rts_credit;
+    bool rts;
+} Src;
+
+// Receiver at the other end of the line
+static struct{
+    uint8_t buf[SINK_SIZE];
+    size_t rdidx;
+    size_t count;
+} Sink;
+
+static int Pty_fd = -1;
+
+// Values the register fields were last armed with
+static USART_t Usart_armed;
+static PORT_t Porta_armed;
+static PORT_t Portd_armed;
+static EDMA_t Edma_armed;
+
+static void advance(void);
+
+//==================================================================================================
+// Helpers
+//==================================================================================================
+
+static void fatal(const char *msg){
+    fprintf(stderr, "hal: %s\n", msg);
+    abort();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Move the emulated clock by the time the CPU takes to run some cycles
+**/
+static void clock_cycles(uint32_t cycles){
+    Clock_frac += (uint64_t)cycles * 1000000000ULL;
+    Clock += Clock_frac / Cfg.f_cpu;
+    Clock_frac %= Cfg.f_cpu;
+}
+
+static struct port *port_of(const void *regs){
+    if(regs == &PORTA) return(&Port[0]);
+    if(regs == &PORTD) return(&Port[1]);
+    return(NULL);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Find the copy of a register field's armed value
+**/
+static host_reg_t *reg_armed(host_reg_t *reg){
+    #define SHADOW(regs, armed) \
+        if(((uintptr_t)reg >= (uintptr_t)&regs) && ((uintptr_t)reg < (uintptr_t)(&regs + 1))){ \
+            return((host_reg_t*)((uintptr_t)&armed + ((uintptr_t)reg - (uintptr_t)&regs))); \
+        }
+
+    SHADOW(USARTD0, Usart_armed);
+    SHADOW(PORTA, Porta_armed);
+    SHADOW(PORTD, Portd_armed);
+    SHADOW(EDMA, Edma_armed);
+
+    #undef SHADOW
+    fatal("Unknown register");
+    return(NULL);
+}
+
+/**
+* \brief Check if a register field was written since it was armed
+* \param reg Register field
+* \param [out] val Written value
+* \param mask Width of the register
+* \return true if written
+**/
+static bool reg_written(host_reg_t *reg, uint16_t *val, uint16_t mask){
+    uint32_t v = *reg;
+
+    *val = v & mask;
+    if((v & 0xFFFF0000UL) != HOST_REG_TAG){
+        // Plain write
+        return(true);
+    }
+    // Read-modify-write if the value changed
+    return(v != *reg_armed(reg));
+}
+
+static void reg_arm(host_reg_t *reg, uint16_t val){
+    *reg = HOST_REG_TAG | val;
+    *reg_armed(reg) = HOST_REG_TAG | val;
+}
+
+//==================================================================================================
+// USART
+//==================================================================================================
+
+/**
+* \brief Number of bits in a frame: start bit, data bits, parity bit and stop bits
+**/
+static uint8_t usart_frame_bits(void){
+    uint8_t bits = 1;
+
+    if((Usart.ctrlc & USART_CHSIZE_gm) == USART_CHSIZE_9BIT_gc){
+        bits += 9;
+    }else{
+        bits += 5 + (Usart.ctrlc & 0x03);
+    }
+    if(Usart.ctrlc & USART_PMODE_gm) bits++;
+    bits += (Usart.ctrlc & USART_SBMODE_bm) ? 2 : 1;
+    return(bits);
+}
+
+static void usart_update_timing(void){
+    uint16_t bsel = Usart.baudctrla | ((Usart.baudctrlb & 0x0F) << 8);
+    int8_t bscale = (int8_t)Usart.baudctrlb >> 4;
+    double div = (Usart.ctrlb & USART_CLK2X_bm) ? 8 : 16;
+    double baud;
+
+    if(bscale >= 0){
+        baud = Cfg.f_cpu / ((double)(1 << bscale) * div * (bsel + 1));
+    }else{
+        baud = Cfg.f_cpu / (div * ((double)bsel / (1 << -bscale) + 1));
+    }
+
+    Usart.frame_ns = (uint64_t)(usart_frame_bits() * 1e9 / baud);
+    if(Usart.frame_ns == 0) Usart.frame_ns = 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+static uint8_t usart_status(void){
+    uint8_t status = 0;
+
+    if(Usart.rx_count){
+        status |= USART_RXCIF_bm | Usart.rx_flags[0];
+    }
+    if(Usart.txcif) status |= USART_TXCIF_bm;
+    if(!Usart.tx_buf_full) status |= USART_DREIF_bm;
+    return(status);
+}
+
+//--------------------------------------------------------------------------------------------------
+static void usart_rx_pop(uint8_t *data, uint8_t *flags){
+    *data = Usart.rx_data[0];
+    *flags = Usart.rx_flags[0];
+    Usart.rx_count--;
+    memmove(Usart.rx_data, Usart.rx_data + 1, Usart.rx_count);
+    memmove(Usart.rx_flags, Usart.rx_flags + 1, Usart.rx_count);
+}
+
+static void usart_rx_push_front(uint8_t data, uint8_t flags){
+    memmove(Usart.rx_data + 1, Usart.rx_data, Usart.rx_count);
+    memmove(Usart.rx_flags + 1, Usart.rx_flags, Usart.rx_count);
+    Usart.rx_data[0] = data;
+    Usart.rx_flags[0] = flags;
+    Usart.rx_count++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief A character arrived at the receiver
+**/
+static void usart_rx_frame(uint8_t data){
+    if(!(Usart.ctrlb & USART_RXEN_bm)) return;
+
+    Stats.rx_frames++;
+    if(Usart.rx_count >= 2){
+        // Receive buffer is full. The character is lost.
+        Usart.rx_flags[Usart.rx_count-1] |= USART_BUFOVF_bm;
+        Stats.rx_dropped++;
+        return;
+    }
+    Usart.rx_data[Usart.rx_count] = data;
+    Usart.rx_flags[Usart.rx_count] = 0;
+    Usart.rx_count++;
+}
+
+//--------------------------------------------------------------------------------------------------
+static bool de_high(void){
+    struct port *p;
+
+    if(!Cfg.de_port) return(false);
+    p = port_of(Cfg.de_port);
+    return(p->in & (1 << Cfg.de_pin));
+}
+
+static bool cts_ready(void){
+    struct port *p;
+
+    if(!Cfg.cts_port) return(true);
+    p = port_of(Cfg.cts_port);
+    return(!(p->in & (1 << Cfg.cts_pin)));
+}
+
+static void usart_tx_start(uint8_t data){
+    Usart.tx_busy = true;
+    Usart.tx_shift = data;
+    Usart.tx_done = Cursor + Usart.frame_ns;
+    Usart.tx_undriven = Cfg.de_port && !de_high();
+    if(!cts_ready()){
+        Stats.tx_after_cts++;
+    }
+}
+
+/**
+* \brief A character was written to DATA
+**/
+static void usart_tx_write(uint8_t data){
+    if(!(Usart.ctrlb & USART_TXEN_bm)) return;
+
+    if(!Usart.tx_busy){
+        usart_tx_start(data);
+    }else if(!Usart.tx_buf_full){
+        Usart.tx_buf = data;
+        Usart.tx_buf_full = true;
+    }else{
+        Stats.tx_overwrites++;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+static void sink_put(uint8_t data){
+    Stats.tx_frames++;
+    if(Pty_fd >= 0){
+        if(write(Pty_fd, &data, 1) < 0){
+            // Nobody is listening on the pty. Drop it like a disconnected line would.
+        }
+        return;
+    }
+    if(Sink.count < SINK_SIZE){
+        Sink.buf[(Sink.rdidx + Sink.count) % SINK_SIZE] = data;
+        Sink.count++;
+    }
+}
+
+/**
+* \brief The shift register finished sending a character
+**/
+static void usart_tx_done(void){
+    sink_put(Usart.tx_shift);
+    if(Usart.tx_undriven){
+        Stats.tx_undriven++;
+    }
+    if(de_high()){
+        // Own transmission on the RS-485 bus
+        usart_rx_frame(Usart.tx_shift);
+    }
+
+    if(Usart.tx_buf_full){
+        Usart.tx_buf_full = false;
+        Usart.tx_busy = false;
+        usart_tx_start(Usart.tx_buf);
+        return;
+    }
+
+    Usart.tx_busy = false;
+    Usart.tx_idle_at = Cursor;
+    Usart.txcif = true;
+    if(Usart.tx_disabling){
+        // Transmitter lets go of the pin once it is done
+        Usart.tx_disabling = false;
+        Port[1].dir &= ~USART_TXPIN;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+static void usart_commit(void){
+    uint16_t v;
+
+    if(reg_written(USARTD0.STATUS_, &v, 0xFF)){
+        if(v & USART_TXCIF_bm){
+            Usart.txcif = false;
+        }
+        if((v & USART_RXCIF_bm) && Usart.rx_count){
+            uint8_t data, flags;
+            usart_rx_pop(&data, &flags);
+        }
+    }
+
+    if(reg_written(USARTD0.CTRLA_, &v, 0xFF)){
+        Usart.ctrla = v;
+    }
+
+    if(reg_written(USARTD0.CTRLB_, &v, 0xFF)){
+        if((Usart.ctrlb & USART_RXEN_bm) && !(v & USART_RXEN_bm)){
+            // Disabling the receiver flushes the receive buffer
+            Usart.rx_count = 0;
+        }
+        if((Usart.ctrlb & USART_TXEN_bm) && !(v & USART_TXEN_bm)){
+            if(Usart.tx_busy){
+                Usart.tx_disabling = true;
+            }else{
+                Port[1].dir &= ~USART_TXPIN;
+            }
+        }
+        Usart.ctrlb = v;
+        usart_update_timing();
+    }
+
+    if(reg_written(USARTD0.CTRLC_, &v, 0xFF)){
+        Usart.ctrlc = v;
+        usart_update_timing();
+    }
+
+    if(reg_written(USARTD0.CTRLD_, &v, 0xFF)){
+        Usart.ctrld = v;
+    }
+
+    if(reg_written(USARTD0.BAUDCTRLA_, &v, 0xFF)){
+        Usart.baudctrla = v;
+        usart_update_timing();
+    }
+
+    if(reg_written(USARTD0.BAUDCTRLB_, &v, 0xFF)){
+        Usart.baudctrlb = v;
+        usart_update_timing();
+    }
+}
+
+static void usart_arm(void){
+    reg_arm(USARTD0.STATUS_, usart_status());
+    reg_arm(USARTD0.CTRLA_, Usart.ctrla);
+    reg_arm(USARTD0.CTRLB_, Usart.ctrlb);
+    reg_arm(USARTD0.CTRLC_, Usart.ctrlc);
+    reg_arm(USARTD0.CTRLD_, Usart.ctrld);
+    reg_arm(USARTD0.BAUDCTRLA_, Usart.baudctrla);
+    reg_arm(USARTD0.BAUDCTRLB_, Usart.baudctrlb);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Commit the DATA access of a context
+**/
+static void data_commit(int ctx){
+    uint32_t v;
+
+    if(!Data_access[ctx].pending) return;
+    Data_access[ctx].pending = false;
+
+    v = USARTD0.DATA_[0];
+    if((v & 0xFFFF0000UL) != HOST_REG_TAG){
+        // It was a write. Give back the character that was popped for a read.
+        if(Data_access[ctx].popped){
+            usart_rx_push_front(Data_access[ctx].data, Data_access[ctx].flags);
+        }
+        usart_tx_write(v & 0xFF);
+    }else if(Data_access[ctx].popped){
+        Usart.last_data = Data_access[ctx].data;
+    }
+}
+
+static void data_arm(int ctx){
+    Data_access[ctx].pending = true;
+    Data_access[ctx].popped = false;
+    if(Usart.rx_count){
+        usart_rx_pop(&Data_access[ctx].data, &Data_access[ctx].flags);
+        Data_access[ctx].popped = true;
+        reg_arm(USARTD0.DATA_, Data_access[ctx].data);
+    }else{
+        reg_arm(USARTD0.DATA_, Usart.last_data);
+    }
+}
+
+//==================================================================================================
+// EDMA
+//==================================================================================================
+
+static uint8_t *dma_ptr(uint16_t addr){
+    uintptr_t p = ((uintptr_t)DMA_Base & ~(uintptr_t)0xFFFF) | addr;
+
+    if(p < (uintptr_t)DMA_Base){
+        fatal("EDMA address is outside of HOST_DMA_MEM");
+    }
+    return((uint8_t*)p);
+}
+
+static void dma_reset(struct dma_ch *ch){
+    ch->ctrla = 0;
+    ch->ctrlb = 0;
+    ch->addrctrl = 0;
+    ch->trigsrc = 0;
+    ch->trfcnt = 0;
+    ch->trfcnt_reload = 0;
+    ch->addr = 0;
+    ch->addr_reload = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Move one byte and handle the end of the block
+**/
+static void dma_transfer(struct dma_ch *ch){
+    uint8_t *p = dma_ptr(ch->addr);
+
+    if(ch->trigsrc == EDMA_CH_TRIGSRC_USARTD0_RXC_gc){
+        uint8_t flags;
+        usart_rx_pop(p, &flags);
+    }else{
+        usart_tx_write(*p);
+    }
+    Stats.dma_bytes++;
+
+    if((ch->addrctrl & EDMA_CH_DIR_gm) == EDMA_CH_DIR_INC_gc){
+        ch->addr++;
+    }else if((ch->addrctrl & EDMA_CH_DIR_gm) == EDMA_CH_DIR_DEC_gc){
+        ch->addr--;
+    }
+
+    if(ch->trfcnt == 0){
+        ch->trfcnt = 256;
+    }
+    ch->trfcnt--;
+    if(ch->trfcnt == 0){
+        // Block is complete
+        ch->ctrlb |= EDMA_CH_TRNIF_bm;
+        ch->trfcnt = ch->trfcnt_reload;
+        if((ch->addrctrl & EDMA_CH_RELOAD_gm) != EDMA_CH_RELOAD_NONE_gc){
+            ch->addr = ch->addr_reload;
+        }
+        if(!(ch->ctrla & EDMA_CH_REPEAT_bm)){
+            ch->ctrla &= ~EDMA_CH_ENABLE_bm;
+        }
+    }
+}
+
+/**
+* \brief Serve the triggers of all enabled channels
+**/
+static void dma_service(void){
+    uint8_t i;
+
+    if(!(Edma_ctrl & EDMA_ENABLE_bm)) return;
+    if(Edma_ctrl & (EDMA_CHMODE_gm | EDMA_DBUFMODE_gm)){
+        // Only 4 peripheral channels without double buffering are emulated
+        return;
+    }
+
+    for(i=0; i<4; i++){
+        struct dma_ch *ch = &Dma[i];
+
+        while(ch->ctrla & EDMA_CH_ENABLE_bm){
+            if((ch->trigsrc == EDMA_CH_TRIGSRC_USARTD0_RXC_gc) && Usart.rx_count){
+                dma_transfer(ch);
+            }else if((ch->trigsrc == EDMA_CH_TRIGSRC_USARTD0_DRE_gc)
+                        && (Usart.ctrlb & USART_TXEN_bm) && !Usart.tx_buf_full){
+                dma_transfer(ch);
+            }else{
+                break;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+static void dma_commit(void){
+    uint16_t v;
+    uint8_t i;
+
+    if(reg_written(EDMA.CTRL_, &v, 0xFF)){
+        if(v & EDMA_RESET_bm){
+            for(i=0; i<4; i++) dma_reset(&Dma[i]);
+            v = 0;
+        }
+        Edma_ctrl = v;
+    }
+
+    for(i=0; i<4; i++){
+        struct dma_ch *ch = &Dma[i];
+        EDMA_CH_t *r = ch->regs;
+
+        if(reg_written(r->CTRLA_, &v, 0xFF)){
+            if(v & EDMA_CH_RESET_bm){
+                dma_reset(ch);
+            }else{
+                ch->ctrla = v;
+            }
+        }
+
+        if(reg_written(r->CTRLB_, &v, 0xFF)){
+            // Flags are cleared by writing 1. CHBUSY and CHPEND are read-only.
+            ch->ctrlb = (ch->ctrlb & ~v & (EDMA_CH_TRNIF_bm | EDMA_CH_ERRIF_bm))
+                        | (v & (EDMA_CH_ERRINTLVL_gm | EDMA_CH_TRNINTLVL_gm));
+        }
+
+        if(reg_written(r->ADDRCTRL_, &v, 0xFF)){
+            ch->addrctrl = v;
+        }
+
+        if(reg_written(r->TRIGSRC_, &v, 0xFF)){
+            ch->trigsrc = v;
+        }
+
+        if(reg_written(r->TRFCNT_, &v, 0xFFFF)){
+            ch->trfcnt = ch->trfcnt_reload = v;
+        }
+        if(reg_written(r->TRFCNTL_, &v, 0xFF)){
+            ch->trfcnt = ch->trfcnt_reload = (ch->trfcnt & 0xFF00) | v;
+        }
+        if(reg_written(r->TRFCNTH_, &v, 0xFF)){
+            ch->trfcnt = ch->trfcnt_reload = (ch->trfcnt & 0x00FF) | (v << 8);
+        }
+
+        if(reg_written(r->ADDRL_, &v, 0xFF)){
+            ch->addr = ch->addr_reload = (ch->addr & 0xFF00) | v;
+        }
+        if(reg_written(r->ADDRH_, &v, 0xFF)){
+            ch->addr = ch->addr_reload = (ch->addr & 0x00FF) | (v << 8);
+        }
+    }
+}
+
+static void dma_arm(void){
+    uint8_t i;
+
+    reg_arm(EDMA.CTRL_, Edma_ctrl);
+    for(i=0; i<4; i++){
+        struct dma_ch *ch = &Dma[i];
+        EDMA_CH_t *r = ch->regs;
+
+        reg_arm(r->CTRLA_, ch->ctrla);
+        reg_arm(r->CTRLB_, ch->ctrlb);
+        reg_arm(r->ADDRCTRL_, ch->addrctrl);
+        reg_arm(r->TRIGSRC_, ch->trigsrc);
+        reg_arm(r->TRFCNT_, ch->trfcnt);
+        reg_arm(r->TRFCNTL_, ch->trfcnt & 0xFF);
+        reg_arm(r->TRFCNTH_, ch->trfcnt >> 8);
+        reg_arm(r->ADDRL_, ch->addr & 0xFF);
+        reg_arm(r->ADDRH_, ch->addr >> 8);
+    }
+}
+
+//==================================================================================================
+// PORT
+//==================================================================================================
+
+/**
+* \brief Update the pin levels and the pin change interrupt flags
+**/
+static void port_sense(struct port *p){
+    uint8_t prev = p->in;
+    uint8_t pin;
+
+    p->in = (p->out & p->dir) | (p->ext & ~p->dir);
+
+    for(pin=0; pin<8; pin++){
+        uint8_t bm = 1 << pin;
+        bool hit;
+
+        switch(p->pinctrl[pin] & PORT_ISC_gm){
+            case PORT_ISC_BOTHEDGES_gc: hit = (prev ^ p->in) & bm; break;
+            case PORT_ISC_RISING_gc:    hit = ~prev & p->in & bm; break;
+            case PORT_ISC_FALLING_gc:   hit = prev & ~p->in & bm; break;
+            case PORT_ISC_LEVEL_gc:     hit = !(p->in & bm); break;
+            default:                    hit = false; break;
+        }
+        if(!hit) continue;
+        if(p->int0mask & bm) p->intflags |= PORT_INT0IF_bm;
+        if(p->int1mask & bm) p->intflags |= PORT_INT1IF_bm;
+    }
+
+    if(Cfg.rts_port && (p == port_of(Cfg.rts_port))){
+        bool rts = p->in & (1 << Cfg.rts_pin);
+        if(rts && !Src.rts){
+            Stats.rts_asserts++;
+        }
+        Src.rts = rts;
+    }
+
+    if(Cfg.de_port && (p == port_of(Cfg.de_port))){
+        uint8_t bm = 1 << Cfg.de_pin;
+        if((prev & bm) && !(p->in & bm)){
+            if(Usart.tx_busy){
+                Usart.tx_undriven = true;
+            }else if(Clock - Usart.tx_idle_at > Stats.de_release_ns){
+                Stats.de_release_ns = Clock - Usart.tx_idle_at;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+static void port_commit(struct port *p){
+    PORT_t *r = p->regs;
+    uint16_t v;
+    uint8_t pin;
+
+    if(reg_written(r->DIR_, &v, 0xFF)) p->dir = v;
+    if(reg_written(r->DIRSET_, &v, 0xFF)) p->dir |= v;
+    if(reg_written(r->DIRCLR_, &v, 0xFF)) p->dir &= ~v;
+    if(reg_written(r->DIRTGL_, &v, 0xFF)) p->dir ^= v;
+
+    if(reg_written(r->OUT_, &v, 0xFF)) p->out = v;
+    if(reg_written(r->OUTSET_, &v, 0xFF)) p->out |= v;
+    if(reg_written(r->OUTCLR_, &v, 0xFF)) p->out &= ~v;
+    if(reg_written(r->OUTTGL_, &v, 0xFF)) p->out ^= v;
+
+    if(reg_written(r->INTCTRL_, &v, 0xFF)) p->intctrl = v;
+    if(reg_written(r->INT0MASK_, &v, 0xFF)) p->int0mask = v;
+    if(reg_written(r->INT1MASK_, &v, 0xFF)) p->int1mask = v;
+    if(reg_written(r->INTFLAGS_, &v, 0xFF)) p->intflags &= ~v;
+
+    for(pin=0; pin<8; pin++){
+        if(reg_written(r->PIN0CTRL_ + pin, &v, 0xFF)) p->pinctrl[pin] = v;
+    }
+}
+
+static void port_arm(struct port *p){
+    PORT_t *r = p->regs;
+    uint8_t pin;
+
+    reg_arm(r->DIR_, p->dir);
+    reg_arm(r->DIRSET_, p->dir);
+    reg_arm(r->DIRCLR_, p->dir);
+    reg_arm(r->DIRTGL_, p->dir);
+    reg_arm(r->OUT_, p->out);
+    reg_arm(r->OUTSET_, p->out);
+    reg_arm(r->OUTCLR_, p->out);
+    reg_arm(r->OUTTGL_, p->out);
+    reg_arm(r->IN_, p->in);
+    reg_arm(r->INTCTRL_, p->intctrl);
+    reg_arm(r->INT0MASK_, p->int0mask);
+    reg_arm(r->INT1MASK_, p->int1mask);
+    reg_arm(r->INTFLAGS_, p->intflags);
+    for(pin=0; pin<8; pin++){
+        reg_arm(r->PIN0CTRL_ + pin, p->pinctrl[pin]);
+    }
+}
+
+//==================================================================================================
+// Interrupts
+//==================================================================================================
+
+/**
+* \brief Find the pending interrupt with the highest level
+* \details Ties go to the lower vector address, like on the chip.
+* \return Handler to call, or NULL if nothing is pending
+**/
+static void (*irq_pending(void))(void){
+    void (*vect)(void) = NULL;
+    uint8_t best = 0;
+    uint8_t i;
+
+    #define IRQ_CHECK(cond, level, handler) \
+        do{ if((cond) && ((level) > best)){ best = (level); vect = (handler); } }while(0)
+
+    for(i=0; i<2; i++){
+        struct port *p = &Port[i];
+        IRQ_CHECK(p->intflags & PORT_INT0IF_bm, p->intctrl & PORT_INT0LVL_gm, p->vect_int0);
+        IRQ_CHECK(p->intflags & PORT_INT1IF_bm, (p->intctrl & PORT_INT1LVL_gm) >> 2, p->vect_int1);
+    }
+    for(i=0; i<4; i++){
+        struct dma_ch *ch = &Dma[i];
+        IRQ_CHECK(ch->ctrlb & EDMA_CH_TRNIF_bm, ch->ctrlb & EDMA_CH_TRNINTLVL_gm, ch->vect);
+        IRQ_CHECK(ch->ctrlb & EDMA_CH_ERRIF_bm, (ch->ctrlb & EDMA_CH_ERRINTLVL_gm) >> 2, ch->vect);
+    }
+    IRQ_CHECK(Usart.rx_count, (Usart.ctrla & USART_RXCINTLVL_gm) >> 4, USARTD0_RXC_vect);
+    IRQ_CHECK(!Usart.tx_buf_full, Usart.ctrla & USART_DREINTLVL_gm, USARTD0_DRE_vect);
+    IRQ_CHECK(Usart.txcif, (Usart.ctrla & USART_TXCINTLVL_gm) >> 2, USARTD0_TXC_vect);
+
+    #undef IRQ_CHECK
+
+    if(best && !vect){
+        fatal("Interrupt enabled without a handler");
+    }
+    return(vect);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Commit everything the CPU or an ISR may have written
+**/
+static void commit(int ctx){
+    data_commit(ctx);
+    usart_commit();
+    dma_commit();
+    port_commit(&Port[0]);
+    port_commit(&Port[1]);
+    port_sense(&Port[0]);
+    port_sense(&Port[1]);
+    dma_service();
+}
+
+static void arm(void){
+    usart_arm();
+    dma_arm();
+    port_arm(&Port[0]);
+    port_arm(&Port[1]);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Run interrupt handlers while any are pending and enabled
+**/
+static void deliver(void){
+    void (*vect)(void);
+    uint8_t i;
+
+    while((host_sreg & CPU_I_bm) && !In_isr){
+        vect = irq_pending();
+        if(!vect) break;
+
+        // Flags that the hardware clears when the vector is executed
+        if(vect == USARTD0_TXC_vect){
+            Usart.txcif = false;
+        }
+        for(i=0; i<2; i++){
+            if(vect == Port[i].vect_int0) Port[i].intflags &= ~PORT_INT0IF_bm;
+            if(vect == Port[i].vect_int1) Port[i].intflags &= ~PORT_INT1IF_bm;
+        }
+
+        arm();
+        In_isr = true;
+        Stats.isr_calls++;
+        clock_cycles(Cfg.isr_cycles);
+        vect();
+        commit(1);
+        In_isr = false;
+    }
+}
+
+//==================================================================================================
+// Time
+//==================================================================================================
+
+static void src_start(uint64_t t){
+    if(Src.busy || (Src.count == 0)) return;
+
+    if(Src.rts){
+        if(Src.rts_credit == 0) return;
+        Src.rts_credit--;
+    }else{
+        Src.rts_credit = Cfg.rts_lag;
+    }
+
+    Src.data = Src.buf[Src.rdidx];
+    Src.rdidx = (Src.rdidx + 1) % SRC_SIZE;
+    Src.count--;
+    Src.busy = true;
+    Src.done = t + Usart.frame_ns;
+}
+
+static void pty_pump(void){
+    uint8_t buf[256];
+    ssize_t len;
+    ssize_t i;
+
+    if(Pty_fd < 0) return;
+
+    while(Src.count < (SRC_SIZE - sizeof(buf))){
+        len = read(Pty_fd, buf, sizeof(buf));
+        if(len <= 0) break;
+        for(i=0; i<len; i++){
+            Src.buf[(Src.rdidx + Src.count) % SRC_SIZE] = buf[i];
+            Src.count++;
+        }
+    }
+}
+
+/**
+* \brief Process everything that happened up to the emulated clock
+* \details Interrupt handlers run on the way move the clock further, so events that fall into them
+*   are processed too.
+**/
+static void advance(void){
+    pty_pump();
+
+    for(;;){
+        uint64_t t = UINT64_MAX;
+
+        if(Src.busy) t = Src.done;
+        if(Usart.tx_busy && (Usart.tx_done < t)) t = Usart.tx_done;
+        if(t > Clock) break;
+
+        Cursor = t;
+        if(Src.busy && (Src.done == t)){
+            Src.busy = false;
+            usart_rx_frame(Src.data);
+        }
+        if(Usart.tx_busy && (Usart.tx_done == t)){
+            usart_tx_done();
+        }
+
+        dma_service();
+        deliver();
+        src_start(Cursor);
+    }
+
+    Cursor = Clock;
+    src_start(Cursor);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Emulator entry for a register access or critical section boundary of the CPU or an ISR
+* \param data The access is to USART DATA
+* \param cycles CPU cycles the access costs
+**/
+static void step(bool data, uint32_t cycles){
+    int ctx = In_isr ? 1 : 0;
+
+    if(Depth){
+        // Called from an ISR that the emulator is running. Events wait until it returns.
+        commit(ctx);
+        clock_cycles(cycles);
+        arm();
+        if(data) data_arm(ctx);
+        return;
+    }
+
+    Depth++;
+    commit(ctx);
+    clock_cycles(cycles);
+    advance();
+    deliver();
+    arm();
+    if(data) data_arm(ctx);
+    Depth--;
+}
+
+//==================================================================================================
+// Hooks for the avr/ and util/ Headers
+//==================================================================================================
+
+uint8_t host_reg_access(void){
+    Stats.reg_accesses++;
+    step(false, Cfg.access_cycles);
+    return(0);
+}
+
+uint8_t host_data_access(void){
+    Stats.reg_accesses++;
+    step(true, Cfg.access_cycles);
+    return(0);
+}
+
+void host_cli(void){
+    __asm__ __volatile__ ("" ::: "memory");
+    step(false, Cfg.access_cycles);
+    host_sreg &= ~CPU_I_bm;
+    __asm__ __volatile__ ("" ::: "memory");
+}
+
+void host_sei(void){
+    __asm__ __volatile__ ("" ::: "memory");
+    host_sreg |= CPU_I_bm;
+    step(false, Cfg.access_cycles);
+}
+
+void host_sreg_restore(uint8_t sreg){
+    __asm__ __volatile__ ("" ::: "memory");
+    host_sreg = sreg;
+    step(false, Cfg.access_cycles);
+}
+
+//==================================================================================================
+// Emulator API
+//==================================================================================================
+
+void host_init(const struct host_config *cfg){
+    uint8_t i;
+
+    Depth = 1;
+
+    Cfg = *cfg;
+    Clock = 0;
+    Clock_frac = 0;
+    Cursor = 0;
+    memset(&Stats, 0, sizeof(Stats));
+    memset(&Usart, 0, sizeof(Usart));
+    memset(Data_access, 0, sizeof(Data_access));
+    memset(&Src, 0, sizeof(Src));
+    memset(&Sink, 0, sizeof(Sink));
+    In_isr = false;
+
+    // Reset values
+    Usart.ctrlc = USART_CHSIZE_8BIT_gc;
+    usart_update_timing();
+
+    Edma_ctrl = 0;
+    Dma[0].regs = &EDMA.CH0;
+    Dma[0].vect = EDMA_CH0_vect;
+    Dma[1].regs = &EDMA.CH1;
+    Dma[1].vect = EDMA_CH1_vect;
+    Dma[2].regs = &EDMA.CH2;
+    Dma[2].vect = EDMA_CH2_vect;
+    Dma[3].regs = &EDMA.CH3;
+    Dma[3].vect = EDMA_CH3_vect;
+    for(i=0; i<4; i++) dma_reset(&Dma[i]);
+
+    memset(Port, 0, sizeof(Port));
+    Port[0].regs = &PORTA;
+    Port[0].vect_int0 = PORTA_INT0_vect;
+    Port[0].vect_int1 = PORTA_INT1_vect;
+    Port[1].regs = &PORTD;
+    Port[1].vect_int0 = PORTD_INT0_vect;
+    Port[1].vect_int1 = PORTD_INT1_vect;
+
+    // Inputs float high, except CTS which is ready
+    Port[0].ext = 0xFF;
+    Port[1].ext = 0xFF;
+    if(port_of(Cfg.cts_port)){
+        port_of(Cfg.cts_port)->ext &= ~(1 << Cfg.cts_pin);
+    }
+    for(i=0; i<2; i++) port_sense(&Port[i]);
+
+    arm();
+    Depth = 0;
+
+    // Interrupts are enabled, like after the application's sei()
+    host_sreg = CPU_I_bm;
+}
+
+//--------------------------------------------------------------------------------------------------
+const char *host_pty_open(void){
+    struct termios tio;
+    const char *name;
+    int master;
+    int slave;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(master < 0) return(NULL);
+    if((grantpt(master) < 0) || (unlockpt(master) < 0)) return(NULL);
+    name = ptsname(master);
+    if(!name) return(NULL);
+
+    // Raw mode, so bytes pass through unchanged. The slave is kept open so the master doesn't
+    // report EIO while nobody else has it open.
+    slave = open(name, O_RDWR | O_NOCTTY);
+    if(slave < 0) return(NULL);
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    Pty_fd = master;
+    return(name);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Let the emulated clock run for a while, delivering interrupts on the way
+**/
+static void run_ns(uint64_t ns){
+    Depth++;
+    commit(0);
+    Clock += ns;
+    advance();
+    deliver();
+    arm();
+    Depth--;
+}
+
+uint64_t host_time_ns(void){
+    return(Clock);
+}
+
+void host_poll(void){
+    step(false, Cfg.access_cycles);
+}
+
+void host_sleep_us(uint32_t us){
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000L;
+    while(nanosleep(&ts, &ts) && (errno == EINTR));
+    run_ns((uint64_t)us * 1000);
+}
+
+void host_delay_us(uint32_t us){
+    run_ns((uint64_t)us * 1000);
+}
+
+uint16_t host_ticks(void){
+    return((uint16_t)(Clock / 1000));
+}
+
+uint32_t host_baud(void){
+    return((uint32_t)(usart_frame_bits() * 1e9 / Usart.frame_ns + 0.5));
+}
+
+uint64_t host_frame_ns(void){
+    return(Usart.frame_ns);
+}
+
+//--------------------------------------------------------------------------------------------------
+void host_rx_send(const void *data, size_t len){
+    const uint8_t *u8 = data;
+
+    while(len && (Src.count < SRC_SIZE)){
+        Src.buf[(Src.rdidx + Src.count) % SRC_SIZE] = *u8++;
+        Src.count++;
+        len--;
+    }
+    if(len){
+        fatal("host_rx_send() overflow");
+    }
+    host_poll();
+}
+
+size_t host_rx_pending(void){
+    return(Src.count + (Src.busy ? 1 : 0));
+}
+
+size_t host_tx_read(void *buf, size_t max){
+    uint8_t *u8 = buf;
+    size_t n = 0;
+
+    while((n < max) && Sink.count){
+        u8[n++] = Sink.buf[Sink.rdidx];
+        Sink.rdidx = (Sink.rdidx + 1) % SINK_SIZE;
+        Sink.count--;
+    }
+    return(n);
+}
+
+size_t host_tx_count(void){
+    return(Sink.count);
+}
+
+void host_set_cts(bool ready){
+    struct port *p;
+
+    p = port_of(Cfg.cts_port);
+    if(!p) return;
+
+    if(ready){
+        p->ext &= ~(1 << Cfg.cts_pin);
+    }else{
+        p->ext |= (1 << Cfg.cts_pin);
+    }
+
+    // Pin change interrupts are raised when the emulator next runs
+    host_poll();
+}
+
+bool host_rts(void){
+    return(Src.rts);
+}
+
+//--------------------------------------------------------------------------------------------------
+void host_get_stats(struct host_stats *stats){
+    *stats = Stats;
+}
+
+void host_reset_stats(void){
+    memset(&Stats, 0, sizeof(Stats));
+}
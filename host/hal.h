@@ -0,0 +1,195 @@
+/**
+* \file
+* \brief Host emulation of the XMEGA USART, EDMA and PORT registers used by uart_io.c
+*
+* Lets uart_io.c be built and run unmodified on a Linux machine in polling, interrupt and DMA mode.
+* The avr/ and util/ headers in this directory stand in for avr-libc.
+*
+* The peripherals run on an emulated clock that the CPU moves forward by a fixed number of cycles per
+* register access, critical section boundary and interrupt. Results don't depend on how the host
+* schedules the process. Received frames take the time that the baud rate set in BAUDCTRLA/B and
+* the frame format in CTRLC give them. The EDMA channels move data on the USART's RXC and DRE
+* triggers. Interrupts are delivered between register accesses and when the interrupt flag is set.
+*
+* The other end of the line is either in-process (host_rx_send(), host_tx_read()) or a pty
+* (host_pty_open()).
+*
+* Differences from the hardware:
+* - Interrupts don't nest. Levels only decide which pending interrupt is taken first.
+* - One USART (USARTD0), PORTA, PORTD and the EDMA with 4 channels are emulated. Each EDMA
+*   channel is a peripheral channel with a 16-bit transfer count. A count of 0 is a block of 256.
+*   The channels don't run if EDMA.CTRL selects another channel mode or double buffering.
+* - EDMA addresses are 16-bit. Buffers the channels access must be declared with HOST_DMA_MEM.
+* - Writing 1 to RXCIF discards the oldest received character.
+* - A read-modify-write that writes a flag back unchanged can't be seen, so it doesn't clear it.
+*   Write-one-to-clear flags must be cleared with a plain write or a write that changes another
+*   bit.
+* - The CPU and ISRs must not both access USART DATA.
+* - While the RS-485 DE output is high, each transmitted character is also received. It arrives when
+*   the transmitter finishes it, not half a bit earlier as on the chip.
+**/
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//==================================================================================================
+// Emulator Setup
+//==================================================================================================
+
+/// Memory that the EDMA can address. Up to 64 kB, shared by all buffers declared with it.
+#define HOST_DMA_MEM    __attribute__ ((section (".noinit")))
+
+struct host_config{
+    uint32_t f_cpu;         ///< CPU and peripheral clock in Hz
+    uint16_t access_cycles; ///< CPU cycles spent per register access or critical section boundary
+    uint16_t isr_cycles;    ///< CPU cycles spent entering and leaving an interrupt handler
+
+    void *rts_port;         ///< PORT_t of the RTS output. NULL if not used.
+    uint8_t rts_pin;        ///< Pin number of RTS
+    uint8_t rts_lag;        ///< Characters the sender still starts after it sees RTS high
+
+    void *cts_port;         ///< PORT_t of the CTS input. NULL if not used.
+    uint8_t cts_pin;        ///< Pin number of CTS
+
+    void *de_port;          ///< PORT_t of the RS-485 driver enable output. NULL if not used.
+    uint8_t de_pin;         ///< Pin number of DE
+};
+
+/**
+* \brief Reset the emulated peripherals and the emulated clock
+* \param cfg Emulator settings
+**/
+void host_init(const struct host_config *cfg);
+
+/**
+* \brief Connect the other end of the line to a new pty
+* \details Characters written to the pty are received at the USART's baud rate. Transmitted
+*   characters are written to the pty instead of being captured for host_tx_read().
+* \return Path of the pty's slave device. NULL on error.
+**/
+const char *host_pty_open(void);
+
+/**
+* \brief Spend the cycles of one register access and deliver pending interrupts
+* \details Needed in loops that wait without accessing any registers. Without it, the emulated
+*   clock doesn't move.
+**/
+void host_poll(void);
+
+/**
+* \brief Busy-wait without accessing any registers, like a delay loop. Interrupts are still
+*   delivered.
+* \param us Time to wait in microseconds
+**/
+void host_delay_us(uint32_t us);
+
+/**
+* \brief Sleep without using the host's CPU, e.g. while waiting for input on the pty
+* \details Like host_delay_us(), but the process also sleeps for that long, so that input from
+*   the pty can arrive in the meantime.
+* \param us Time to sleep in microseconds
+**/
+void host_sleep_us(uint32_t us);
+
+/**
+* \brief Time of the emulated clock since host_init() in nanoseconds
+**/
+uint64_t host_time_ns(void);
+
+/**
+* \brief Free-running 16-bit microsecond counter. Used for UART_STATS_TICKS()
+**/
+uint16_t host_ticks(void);
+
+/**
+* \brief Baud rate that the USART's BAUDCTRLA/B and CLK2X settings produce
+**/
+uint32_t host_baud(void);
+
+/**
+* \brief Time it takes to send one character with the current USART settings, in nanoseconds
+**/
+uint64_t host_frame_ns(void);
+
+//==================================================================================================
+// Other End of the Line
+//==================================================================================================
+
+/**
+* \brief Queue characters for the sender
+* \details They are sent back to back, unless RTS stops the sender.
+**/
+void host_rx_send(const void *data, size_t len);
+
+/**
+* \brief Number of queued characters that the sender hasn't finished yet
+**/
+size_t host_rx_pending(void);
+
+/**
+* \brief Read characters the USART has finished transmitting
+* \return Number of characters read
+**/
+size_t host_tx_read(void *buf, size_t max);
+
+/**
+* \brief Number of transmitted characters waiting to be read with host_tx_read()
+**/
+size_t host_tx_count(void);
+
+/**
+* \brief Drive the CTS input
+* \param ready true drives it low (clear to send). false drives it high.
+**/
+void host_set_cts(bool ready);
+
+/**
+* \brief Check the RTS output
+* \return true if RTS is high, requesting the sender to stop
+**/
+bool host_rts(void);
+
+struct host_stats{
+    uint32_t reg_accesses;  ///< Register accesses by the CPU and ISRs
+    uint32_t isr_calls;     ///< Interrupt handlers run
+    uint32_t rx_frames;     ///< Characters that arrived at the receiver
+    uint32_t rx_dropped;    ///< Characters lost because the receive buffer was full (BUFOVF)
+    uint32_t tx_frames;     ///< Characters transmitted
+    uint32_t tx_overwrites; ///< DATA writes while the transmit buffer was full. Data lost.
+    uint32_t tx_after_cts;  ///< Characters started while CTS was high
+    uint32_t rts_asserts;   ///< Number of times RTS went high
+    uint32_t tx_undriven;   ///< Characters that DE didn't drive onto the bus from start to end
+    uint32_t de_release_ns; ///< Longest time from the transmitter going idle to DE going low
+    uint32_t dma_bytes;     ///< Bytes moved by the EDMA
+};
+
+/**
+* \brief Get the emulator's counters
+**/
+void host_get_stats(struct host_stats *stats);
+
+/**
+* \brief Reset the emulator's counters to 0
+**/
+void host_reset_stats(void);
+
+//==================================================================================================
+// Used by the avr/ and util/ Headers
+//==================================================================================================
+///\cond INTERNAL
+#define HOST_REG_TAG    0x5A5A0000UL
+
+extern volatile uint8_t host_sreg;
+
+uint8_t host_reg_access(void);
+uint8_t host_data_access(void);
+void host_cli(void);
+void host_sei(void);
+void host_sreg_restore(uint8_t sreg);
+///\endcond
+
+#endif
@@ -0,0 +1,237 @@
+/**
+* \file
+* \brief uart_io configuration for the host build
+* \details Based on uart_io_config.TEMPLATE.h. The Makefile selects the variant:
+*   - HOST_MODE: RX and TX mode (0 = Polling, 1 = Interrupt, 2 = DMA)
+*   - HOST_FLOW: 1 enables RX flow control, and TX flow control in interrupt mode
+*   - HOST_RX_BUF_SIZE, HOST_TX_BUF_SIZE: Buffer sizes
+*   - HOST_ASYNC_EVENT: 1 pushes the uart_read_async() callback into the event queue
+*   - HOST_RS485: 1 enables RS-485 mode
+*   - HOST_LINE: 1 enables the line discipline
+**/
+
+#ifndef UART_IO_CONFIG_H
+#define UART_IO_CONFIG_H
+
+#ifndef HOST_MODE
+    #define HOST_MODE   0
+#endif
+#ifndef HOST_FLOW
+    #define HOST_FLOW   0
+#endif
+#ifndef HOST_RX_BUF_SIZE
+    #define HOST_RX_BUF_SIZE    64
+#endif
+#ifndef HOST_TX_BUF_SIZE
+    #define HOST_TX_BUF_SIZE    64
+#endif
+#ifndef HOST_ASYNC_EVENT
+    #define HOST_ASYNC_EVENT    0
+#endif
+#ifndef HOST_RS485
+    #define HOST_RS485  0
+#endif
+#ifndef HOST_LINE
+    #define HOST_LINE   0
+#endif
+
+//==================================================================================================
+// UART Configuration
+//==================================================================================================
+
+#define UART_RX_MODE    HOST_MODE
+#define UART_TX_MODE    HOST_MODE
+//  0 = Polling
+//  1 = Interrupt
+//  2 = DMA
+
+// Select a UART Device
+#define UART_DEV        USARTD0
+#define UART_DEV_PORT   PORTD
+#define UART_TXPIN      PIN3_bm
+#define UART_RXPIN      PIN2_bm
+
+// Baud rate in Hz
+#define BAUD_RATE       115200L
+
+// CPU Clock in Hz
+#define F_CPU           32000000L
+
+// Buffer sizes. Max is 32768 for DMA mode.
+// In DMA mode, sizes above 256 use 16-bit indexes and DMA transfer counts (TRFCNTH). The selected
+// EDMA channels must support 16-bit transfer counts.
+#define RX_BUF_SIZE     HOST_RX_BUF_SIZE
+#define TX_BUF_SIZE     HOST_TX_BUF_SIZE
+
+//==================================================================================================
+// Autobaud
+//==================================================================================================
+// If enabled, uart_autobaud() measures a sync character using the timer AUTOBAUD_TC
+#define UART_AUTOBAUD_EN    0
+#define AUTOBAUD_TC         TCC5
+
+// Lowest baud rate to detect. uart_autobaud() gives up after 2 bit times at this rate with no edge
+#define AUTOBAUD_MIN_RATE   1200L
+
+//==================================================================================================
+// TX Flow Control (Only supported if UART_TX_MODE == 1)
+//==================================================================================================
+#define TX_FLOW_CONTROL_EN  (HOST_FLOW && (HOST_MODE == 1))
+#define TX_FLOW_PORT        PORTA
+#define TX_FLOW_PIN         0
+
+// Set interrupt level
+#define TX_FLOW_INTERRUPT_LEVEL 2
+//  1 = Low
+//  2 = Med
+//  3 = High
+
+// Set interrupt ID to use (0 or 1)
+#define TX_FLOW_INTERRUPT_ID    0
+
+// Interrupt vector for CTS pin's port
+#define TX_FLOW_PIN_VECTOR      PORTA_INT0_vect
+
+//==================================================================================================
+// RX Flow Control (Only supported if UART_RX_MODE == 1 or 2)
+//==================================================================================================
+// RTS output is driven high to request the sender to stop once the number of unread bytes reaches
+// RX_FLOW_HIGH. It is driven low again once the unread bytes drop to RX_FLOW_LOW.
+#define RX_FLOW_CONTROL_EN  (HOST_FLOW && (HOST_MODE != 0))
+#define RX_FLOW_PORT        PORTA
+#define RX_FLOW_PIN         1
+
+// Watermarks in bytes
+#if(HOST_MODE == 2)
+    #define RX_FLOW_HIGH    (RX_BUF_SIZE - RX_BUF_SIZE/RX_FLOW_DMA_SEGMENTS - 16)
+    #define RX_FLOW_LOW     (RX_BUF_SIZE/4)
+#else
+    #define RX_FLOW_HIGH    (RX_BUF_SIZE*5/8)
+    #define RX_FLOW_LOW     (RX_BUF_SIZE/4)
+#endif
+
+// DMA mode only: Number of DMA blocks that RX_BUF_SIZE is split into. Watermarks are checked at the
+// end of each block, so RX_FLOW_HIGH needs at least RX_BUF_SIZE/RX_FLOW_DMA_SEGMENTS bytes of
+// headroom, plus whatever the sender transmits before it reacts to RTS.
+#define RX_FLOW_DMA_SEGMENTS    4
+
+//==================================================================================================
+// RX Event Notifications (Only supported if UART_RX_MODE == 1 or 2)
+//==================================================================================================
+// Allows uart_rx_event_start() to post an event into the event queue when received data needs
+// attention. Requires the event_queue module, and the rtc module with RTC_TIMER_ENABLE.
+#define RX_EVENT_EN         0
+
+// In DMA mode, received data is only inspected from an RTC timer. This is the timer interval (in
+// RTC ticks). It is the latency of delimiter and threshold events, and the resolution of idle_ticks.
+#define RX_EVENT_DMA_POLL_TICKS 2
+
+//==================================================================================================
+// RS-485 Half-Duplex (Only supported if UART_RX_MODE and UART_TX_MODE are 1 or 2)
+//==================================================================================================
+// The driver enable (DE) output is driven high when transmission starts, and low from the transmit
+// complete interrupt once the last stop bit was sent and nothing else is queued. Characters
+// received while DE is high are our own transmission and are discarded. In RX DMA mode, this is
+// done by RX_ISR_VECTOR while DE is high.
+// DE goes low about 55 CPU cycles after the end of the stop bit (1.7us at 32 MHz), plus the time
+// any interrupt of the same or a higher level is running.
+#define RS485_EN            HOST_RS485
+#define RS485_DE_PORT       PORTD
+#define RS485_DE_PIN        1
+
+// Transmit complete interrupt
+#define TXC_ISR_VECTOR      USARTD0_TXC_vect
+#define TXC_ISR_INTLVL      USART_TXCINTLVL_HI_gc
+
+//==================================================================================================
+// Line Discipline (Only supported if UART_RX_MODE == 1)
+//==================================================================================================
+// Received characters are assembled into lines in place in the RX buffer, handling backspace and
+// CR/LF. Complete lines are read using uart_line_get(). RX_BUF_SIZE limits the line length. Each
+// line takes 2 bytes of the RX buffer on top of its characters.
+#define UART_LINE_EN        HOST_LINE
+
+//==================================================================================================
+// Multi-Processor Communication Mode (Only supported if UART_RX_MODE == 1)
+//==================================================================================================
+// Uses 9-bit frames for multidrop buses. Frames with the 9th bit set are addresses. Data frames sent
+// to other nodes are discarded by the USART without causing an RX interrupt.
+#define UART_MPCM_EN        0
+
+// Address of this node after uart_init(). Can be changed using uart_set_address()
+#define UART_MPCM_ADDRESS   0x01
+
+// Address that selects all nodes
+#define UART_MPCM_BROADCAST 0xFF
+
+//==================================================================================================
+// TX Coalescing (Only supported if UART_TX_MODE == 2)
+//==================================================================================================
+// Instead of starting a DMA transfer as soon as data is written, hold it until at least
+// TX_COALESCE_THRESHOLD bytes are waiting, or TX_COALESCE_TICKS RTC ticks have passed. Data written
+// while a transfer is in progress is always sent when it completes. uart_flush() sends held data
+// immediately. Requires the rtc module with RTC_TIMER_ENABLE.
+// Writing to the UART starts the timer if it isn't running. When that happens in an ISR, the ISR
+// also runs timer_start(), which may wait for the RTC to synchronize.
+#define TX_COALESCE_EN          0
+#define TX_COALESCE_THRESHOLD   16
+#define TX_COALESCE_TICKS       2
+
+//==================================================================================================
+// Async Read Completion (Only used if UART_RX_MODE == 2)
+//==================================================================================================
+// If enabled, the uart_read_async() callback is pushed into the event queue instead of being
+// called from the RX DMA interrupt. Requires the event_queue module.
+#define RX_ASYNC_EVENT_EN   HOST_ASYNC_EVENT
+
+//==================================================================================================
+// Statistics
+//==================================================================================================
+// If enabled, traffic, error and buffer usage counters can be read using uart_get_stats()
+#define UART_STATS_EN       1
+
+// Free-running 16-bit timebase used to measure how long TX was blocked by CTS. (e.g. RTC.CNT or
+// the CNT register of a spare timer). Stalls longer than one timebase period are under-counted.
+// Set to 0 if not needed.
+#define UART_STATS_TICKS()  host_ticks()
+
+//==================================================================================================
+// Interrupt mode configuration (If UART_XX_MODE == 1)
+//==================================================================================================
+// Without flow control, events, RS-485, MPCM or statistics, RX_ISR_VECTOR takes about 90 CPU cycles
+// per character and TX_ISR_VECTOR about 85, including interrupt entry and exit. These are counted
+// from XMEGA instruction timings, not measured. At 32 MHz and 8N1, the RX interrupt uses about 26%
+// of the CPU at 921600 baud and can keep up with at most about 3.5 Mbaud.
+#define RX_ISR_VECTOR   USARTD0_RXC_vect
+#define TX_ISR_VECTOR   USARTD0_DRE_vect
+
+#define RX_ISR_INTLVL   USART_RXCINTLVL_HI_gc
+#define TX_ISR_INTLVL   USART_DREINTLVL_HI_gc
+
+//==================================================================================================
+// DMA Configuration (If UART_XX_MODE == 2)
+//==================================================================================================
+
+// DMA Trigger sources
+#define RX_DMA_TRIGSRC  EDMA_CH_TRIGSRC_USARTD0_RXC_gc
+#define TX_DMA_TRIGSRC  EDMA_CH_TRIGSRC_USARTD0_DRE_gc
+
+// Select a DMA Channel
+#define RX_DMA_CH       CH0
+#define RX_DMA_VECTOR   EDMA_CH0_vect
+
+// Select a DMA Channel
+#define TX_DMA_CH       CH1
+#define TX_DMA_VECTOR   EDMA_CH1_vect
+
+// Select an interrupt priority level
+#define RX_DMA_INTLVL   (EDMA_CH_TRNINTLVL1_bm | EDMA_CH_TRNINTLVL0_bm) // Highest priority
+// RS-485: Below TXC, so that TXC can run while the next transfer is still waiting to be started
+#if(HOST_RS485 == 1)
+    #define TX_DMA_INTLVL   EDMA_CH_TRNINTLVL0_bm
+#else
+    #define TX_DMA_INTLVL   (EDMA_CH_TRNINTLVL1_bm | EDMA_CH_TRNINTLVL0_bm) // Highest priority
+#endif
+
+
+#endif
@@ -0,0 +1,70 @@
+/**
+* \file
+* \brief Echoes everything received on a pty through uart_io.c in DMA mode
+*
+* Prints the path of the pty, then runs until interrupted. Connect to it with any terminal program,
+* e.g. `picocom /dev/pts/5`. Characters are paced at the emulated baud rate in both directions.
+*
+* Usage: uart_pty [-b baud]
+**/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "hal.h"
+#include "uart_io.h"
+#include <uart_io_config.h>
+
+int main(int argc, char *argv[]){
+    struct host_config cfg = {
+        .f_cpu = F_CPU,
+        .access_cycles = 8,
+        .isr_cycles = 40,
+    };
+    uint8_t buf[64];
+    const char *name;
+    size_t len;
+    int opt;
+
+    host_init(&cfg);
+    uart_init();
+
+    while((opt = getopt(argc, argv, "b:")) != -1){
+        switch(opt){
+            case 'b': uart_set_baud(strtoul(optarg, NULL, 0)); break;
+            default:
+                fprintf(stderr, "Usage: %s [-b baud]\n", argv[0]);
+                return(2);
+        }
+    }
+
+    name = host_pty_open();
+    if(!name){
+        perror("host_pty_open");
+        return(1);
+    }
+    printf("%s at %lu baud\n", name, (unsigned long)host_baud());
+    fflush(stdout);
+
+    for(;;){
+        len = uart_rdcount();
+        if(len > sizeof(buf)){
+            len = sizeof(buf);
+        }
+        if(len){
+            uart_read(buf, len);
+            uart_write(buf, len);
+            uart_flush();
+        }else{
+            host_sleep_us(500);
+        }
+    }
+    return(0);
+}
@@ -0,0 +1,691 @@
+/**
+* \file
+* \brief Runs uart_io.c against the emulated USART, EDMA and PORT registers
+*
+* Built once per mode by the Makefile. Checks data integrity, throughput, overrun handling and flow
+* control, and prints how much register and interrupt work each byte costs.
+*
+* Usage: uart_test [-b baud] [-n bytes]
+**/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "hal.h"
+#include "uart_io.h"
+#include "event_queue.h"
+#include <uart_io_config.h>
+
+#if(HOST_MODE == 0)
+    #define MODE_NAME   "poll"
+#elif(HOST_MODE == 1)
+    #define MODE_NAME   "intr"
+#else
+    #define MODE_NAME   "dma"
+#endif
+
+#define RX_FLOW (RX_FLOW_CONTROL_EN == 1)
+#define TX_FLOW (TX_FLOW_CONTROL_EN == 1)
+#define RS485   (RS485_EN == 1)
+#define LINE    (UART_LINE_EN == 1)
+
+#define ASYNC_SIZE  ((RX_BUF_SIZE > 256) ? 600 : 200)
+
+// Size of one block of the driver's RX DMA ring
+#define RX_SEG_SIZE (RX_FLOW ? (RX_BUF_SIZE / RX_FLOW_DMA_SEGMENTS) : RX_BUF_SIZE)
+
+static uint8_t Async_buf[ASYNC_SIZE] HOST_DMA_MEM;
+static volatile bool Async_done;
+
+static uint8_t Tx_data[65536];
+static uint8_t Rx_data[65536];
+
+static unsigned Failures;
+
+#define CHECK(cond) \
+    do{ \
+        if(!(cond)){ \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            Failures++; \
+        } \
+    }while(0)
+
+//==================================================================================================
+// Helpers
+//==================================================================================================
+
+/**
+* \brief Fill a buffer with a pseudo-random pattern
+**/
+static void pattern(uint8_t *buf, size_t len, uint32_t seed){
+    size_t i;
+    for(i=0; i<len; i++){
+        seed = seed * 1103515245UL + 12345;
+        buf[i] = seed >> 16;
+    }
+}
+
+/**
+* \brief Time of n characters in nanoseconds
+**/
+static uint64_t frames_ns(size_t n){
+    return(host_frame_ns() * n);
+}
+
+/**
+* \brief Read from the driver until len bytes arrived or nothing arrives for a while
+* \return Number of bytes read
+**/
+static size_t rx_collect(uint8_t *buf, size_t len){
+    uint64_t deadline = host_time_ns() + frames_ns(64);
+    size_t got = 0;
+    size_t n;
+
+    while((got < len) && (host_time_ns() < deadline)){
+        n = uart_rdcount();
+        if(n == 0){
+            // Wait without accessing registers, so the costs printed are the driver's own
+            host_delay_us(host_frame_ns() / 2000);
+            continue;
+        }
+        if(n > len - got){
+            n = len - got;
+        }
+        uart_read(buf + got, n);
+        got += n;
+        deadline = host_time_ns() + frames_ns(64);
+    }
+    return(got);
+}
+
+/**
+* \brief Wait until the other end received len bytes or nothing arrives for a while
+* \return Number of bytes read
+**/
+static size_t tx_collect(uint8_t *buf, size_t len){
+    uint64_t deadline = host_time_ns() + frames_ns(64);
+    size_t got = 0;
+    size_t n;
+
+    while((got < len) && (host_time_ns() < deadline)){
+        n = host_tx_read(buf + got, len - got);
+        if(n == 0){
+            host_poll();
+            continue;
+        }
+        got += n;
+        deadline = host_time_ns() + frames_ns(64);
+    }
+    return(got);
+}
+
+/**
+* \brief Discard everything that is still arriving
+**/
+static void rx_drain(void){
+    uint64_t quiet = host_time_ns() + frames_ns(8);
+
+    while(host_time_ns() < quiet){
+        if(host_rx_pending() || uart_rdcount()){
+            uart_rdflush();
+            quiet = host_time_ns() + frames_ns(8);
+        }
+        host_poll();
+    }
+    uart_rdflush();
+}
+
+static void reset_stats(void){
+    host_reset_stats();
+    uart_reset_stats();
+}
+
+static void print_cost(const char *name, size_t bytes, uint64_t ns){
+    struct host_stats hs;
+
+    host_get_stats(&hs);
+    printf("  %s: %zu bytes in %.1f ms, %.0f%% of line rate, %.1f register accesses and %.2f ISRs "
+        "per byte\n", name, bytes, ns / 1e6, 100.0 * frames_ns(bytes) / ns,
+        (double)hs.reg_accesses / bytes, (double)hs.isr_calls / bytes);
+}
+
+//==================================================================================================
+// Tests
+//==================================================================================================
+
+/**
+* \brief Receive a back-to-back stream
+**/
+static void test_rx(size_t n){
+    struct uart_stats us;
+    struct host_stats hs;
+    uint64_t start;
+    uint64_t ns;
+    size_t got;
+
+    printf("rx\n");
+    rx_drain();
+    reset_stats();
+    pattern(Tx_data, n, 1);
+
+    start = host_time_ns();
+    host_rx_send(Tx_data, n);
+    got = rx_collect(Rx_data, n);
+    ns = host_time_ns() - start;
+
+    CHECK(got == n);
+    CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+    uart_get_stats(&us);
+    host_get_stats(&hs);
+    CHECK(hs.rx_dropped == 0);
+    CHECK(us.hw_overflows == 0);
+    CHECK(us.rx_overruns == 0);
+    CHECK(us.rx_bytes == n);
+
+    // Receiving can't be faster than the line. Anything much slower means the driver falls behind.
+    CHECK(ns >= frames_ns(n - 1));
+    CHECK(ns < frames_ns(n) * 11 / 10 + frames_ns(64));
+    print_cost("rx", n, ns);
+}
+
+/**
+* \brief Transmit a stream
+**/
+static void test_tx(size_t n){
+    struct uart_stats us;
+    struct host_stats hs;
+    uint64_t start;
+    uint64_t ns;
+    size_t got;
+
+    printf("tx\n");
+    reset_stats();
+    pattern(Tx_data, n, 2);
+
+    start = host_time_ns();
+    uart_write(Tx_data, n);
+    uart_flush();
+    if((HOST_MODE == 2) || RS485){
+        // The last character was shifted out too
+        CHECK(host_tx_count() == n);
+    }
+    got = tx_collect(Rx_data, n);
+    ns = host_time_ns() - start;
+
+    CHECK(got == n);
+    CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+    uart_get_stats(&us);
+    host_get_stats(&hs);
+    CHECK(hs.tx_overwrites == 0);
+    CHECK(hs.tx_frames == n);
+    CHECK(hs.tx_undriven == 0);
+    CHECK(us.tx_bytes == n);
+    CHECK(ns < frames_ns(n) * 11 / 10 + frames_ns(64));
+    print_cost("tx", n, ns);
+}
+
+/**
+* \brief Send back everything that is received, in both directions at once
+**/
+static void test_echo(size_t n){
+    uint8_t buf[64];
+    uint64_t start;
+    uint64_t deadline;
+    uint64_t ns;
+    size_t echoed = 0;
+    size_t got = 0;
+    size_t len;
+
+    printf("echo\n");
+    rx_drain();
+    reset_stats();
+    pattern(Tx_data, n, 3);
+
+    start = host_time_ns();
+    host_rx_send(Tx_data, n);
+    deadline = host_time_ns() + frames_ns(64);
+    while(((echoed < n) || (got < n)) && (host_time_ns() < deadline)){
+        len = uart_rdcount();
+        if(len > sizeof(buf)){
+            len = sizeof(buf);
+        }
+        if(len){
+            uart_read(buf, len);
+            uart_write(buf, len);
+            uart_flush();
+            echoed += len;
+            deadline = host_time_ns() + frames_ns(64);
+        }
+        len = host_tx_read(Rx_data + got, n - got);
+        if(len){
+            got += len;
+            deadline = host_time_ns() + frames_ns(64);
+        }
+        host_poll();
+    }
+    ns = host_time_ns() - start;
+
+    CHECK(echoed == n);
+    CHECK(got == n);
+    CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+    print_cost("echo", n, ns);
+}
+
+/**
+* \brief Stall the reader long enough to fill the RX buffer
+**/
+static void test_overrun(void){
+    struct uart_stats us;
+    struct host_stats hs;
+    size_t n = RX_BUF_SIZE * 2 + 64;
+    size_t got;
+
+    printf("overrun\n");
+    rx_drain();
+    reset_stats();
+    pattern(Tx_data, n, 4);
+
+    host_rx_send(Tx_data, n);
+    host_delay_us(frames_ns(n + 16) / 1000);
+
+    uart_get_stats(&us);
+    host_get_stats(&hs);
+    if(RX_FLOW){
+        // RTS must have stopped the sender before anything was lost
+        CHECK(hs.rts_asserts > 0);
+        CHECK(host_rx_pending() > 0);
+        got = rx_collect(Rx_data, n);
+        uart_get_stats(&us);
+        host_get_stats(&hs);
+        CHECK(got == n);
+        CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+        CHECK(hs.rx_dropped == 0);
+        CHECK(us.rx_overruns == 0);
+        CHECK(!host_rts());
+        printf("  RTS asserted %u times, nothing lost\n", (unsigned)hs.rts_asserts);
+    }else{
+        got = rx_collect(Rx_data, n);
+        uart_get_stats(&us);
+        host_get_stats(&hs);
+        CHECK(got < n);
+        if(HOST_MODE == 0){
+            // Nothing drained the USART. Its receive buffer overflowed.
+            CHECK(hs.rx_dropped > 0);
+            CHECK(us.hw_overflows > 0);
+        }else{
+            // The USART was drained in time, but the driver's buffer overran
+            CHECK(hs.rx_dropped == 0);
+            CHECK(us.rx_overruns > 0);
+            CHECK(us.rx_bytes_lost > 0);
+        }
+        printf("  %zu of %zu bytes kept, %u dropped by the USART, %u overruns\n", got, n,
+            (unsigned)hs.rx_dropped, (unsigned)us.rx_overruns);
+    }
+
+    // The driver must be back to normal afterwards
+    rx_drain();
+    reset_stats();
+    pattern(Tx_data, 100, 5);
+    host_rx_send(Tx_data, 100);
+    got = rx_collect(Rx_data, 100);
+    CHECK(got == 100);
+    CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+}
+
+/**
+* \brief Stop and resume transmission using CTS
+**/
+static void test_cts(void){
+    struct uart_stats us;
+    struct host_stats hs;
+    size_t n = TX_BUF_SIZE * 3 / 4;
+    size_t stopped;
+    size_t got;
+
+    printf("cts\n");
+    reset_stats();
+    pattern(Tx_data, n, 6);
+
+    uart_write(Tx_data, n);
+    host_delay_us(frames_ns(n / 4) / 1000);
+    host_set_cts(false);
+    stopped = host_tx_count();
+    host_delay_us(frames_ns(n) / 1000);
+
+    // A character that already started, and the one in the USART's buffer, still go out
+    got = host_tx_count();
+    CHECK(got < n);
+    CHECK(got <= stopped + 2);
+
+    host_set_cts(true);
+    got = tx_collect(Rx_data, n);
+    CHECK(got == n);
+    CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+
+    uart_get_stats(&us);
+    host_get_stats(&hs);
+    CHECK(us.cts_stalls > 0);
+    CHECK(hs.tx_after_cts <= 1);
+    printf("  %u stalls, %u characters started after CTS went high\n", (unsigned)us.cts_stalls,
+        (unsigned)hs.tx_after_cts);
+}
+
+/**
+* \brief Take turns on the RS-485 bus
+**/
+static void test_rs485(void){
+    struct uart_stats us;
+    struct host_stats hs;
+    size_t n = TX_BUF_SIZE / 4;
+    size_t got;
+
+    printf("rs485\n");
+    rx_drain();
+    reset_stats();
+    pattern(Tx_data, 2*n, 8);
+
+    // Received before transmitting, but not read yet
+    host_rx_send(Tx_data, n);
+    host_delay_us(frames_ns(n + 2) / 1000);
+    uart_write(Tx_data + n, n);
+    uart_flush();
+    got = tx_collect(Rx_data, n);
+    CHECK(got == n);
+    CHECK(memcmp(Rx_data, Tx_data + n, got) == 0);
+    host_delay_us(frames_ns(2) / 1000);
+    CHECK(!(RS485_DE_PORT.IN & (1 << RS485_DE_PIN)));
+
+    // It is still there. Our own transmission isn't.
+    got = rx_collect(Rx_data, 2*n);
+    CHECK(got == n);
+    CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+
+    // The reply is received
+    host_rx_send(Tx_data + n, n);
+    got = rx_collect(Rx_data, n);
+    CHECK(got == n);
+    CHECK(memcmp(Rx_data, Tx_data + n, got) == 0);
+
+    if(HOST_MODE == 2){
+        // A transfer is queued behind the one running, and TXC is taken before the transfer
+        // complete interrupt. The bus must be kept until both are sent.
+        cli();
+        uart_write(Tx_data, n);
+        uart_write(Tx_data + n, n);
+        host_delay_us(frames_ns(n + 2) / 1000);
+        sei();
+        got = tx_collect(Rx_data, 2*n);
+        CHECK(got == 2*n);
+        CHECK(memcmp(Rx_data, Tx_data, got) == 0);
+        host_delay_us(frames_ns(2) / 1000);
+        CHECK(!(RS485_DE_PORT.IN & (1 << RS485_DE_PIN)));
+        CHECK(rx_collect(Rx_data, 1) == 0);
+    }
+
+    uart_get_stats(&us);
+    host_get_stats(&hs);
+    CHECK(us.de_asserts == ((HOST_MODE == 2) ? 2 : 1));
+    CHECK(hs.tx_undriven == 0);
+    CHECK(hs.de_release_ns < host_frame_ns() / 10);
+    printf("  DE released %.2f us after the last stop bit\n", hs.de_release_ns / 1e3);
+}
+
+/**
+* \brief Check that the next line is there and what it contains
+**/
+static void line_expect(const void *data, size_t n){
+    char buf[RX_BUF_SIZE];
+    size_t len = 0;
+
+    CHECK(uart_line_get(buf, sizeof(buf), &len));
+    CHECK(len == n);
+    CHECK(memcmp(buf, data, n) == 0);
+    CHECK(buf[len] == 0);
+}
+
+/**
+* \brief Send a line of printable characters followed by LF
+**/
+static void line_send(uint8_t *line, size_t n, uint32_t seed){
+    size_t i;
+
+    pattern(line, n, seed);
+    for(i=0; i<n; i++){
+        line[i] = 'A' + (line[i] % 26);
+    }
+    line[n] = '\n';
+    host_rx_send(line, n + 1);
+}
+
+/**
+* \brief Assemble lines with the line discipline
+**/
+static void test_line(void){
+    static const char input[] = "first\r\nsec\bxond\n\r\0bin\0ary\r";
+    struct uart_stats us;
+    size_t half = RX_BUF_SIZE/2 - 3;
+    char buf[4];
+    size_t len;
+    size_t i;
+
+    printf("line\n");
+    rx_drain();
+    reset_stats();
+
+    host_rx_send(input, sizeof(input) - 1);
+    host_delay_us(frames_ns(sizeof(input) + 2) / 1000);
+    line_expect("first", 5);
+    line_expect("sexond", 6);
+    line_expect("", 0);
+    line_expect("\0bin\0ary", 8);
+    CHECK(!uart_line_get(buf, sizeof(buf), &len));
+
+    // Lines wrap around the end of the RX buffer at every offset. Two of them fit at once.
+    for(i=0; i<RX_BUF_SIZE; i++){
+        line_send(Tx_data, half - (i % 2), 2*i);
+        line_send(Tx_data + half, half, 2*i + 1);
+        host_delay_us(frames_ns(2*half + 4) / 1000);
+        line_expect(Tx_data, half - (i % 2));
+        line_expect(Tx_data + half, half);
+    }
+
+    // Longer lines are truncated
+    line_send(Tx_data, 10, 1);
+    host_delay_us(frames_ns(12) / 1000);
+    CHECK(uart_line_get(buf, sizeof(buf), &len));
+    CHECK((len == 3) && (memcmp(buf, Tx_data, 3) == 0) && (buf[3] == 0));
+
+    // Characters that don't fit in the RX buffer are dropped
+    reset_stats();
+    line_send(Tx_data, RX_BUF_SIZE + 10, 2);
+    host_delay_us(frames_ns(RX_BUF_SIZE + 12) / 1000);
+    line_expect(Tx_data, RX_BUF_SIZE - 3);
+    uart_get_stats(&us);
+    CHECK(us.rx_bytes_lost == 13);
+}
+
+void onIdle(void){
+}
+
+static void async_callback(void){
+    Async_done = true;
+}
+
+/**
+* \brief Run events until the uart_read_async() callback was called or a deadline passes
+**/
+static void async_wait(size_t len){
+    uint64_t deadline = host_time_ns() + frames_ns(len + 64);
+
+    while(!Async_done && (host_time_ns() < deadline)){
+        host_poll();
+        event_YieldEvent();
+    }
+}
+
+/**
+* \brief Read into a caller buffer with uart_read_async()
+**/
+static void test_async(void){
+    uint8_t other[8];
+    size_t head = 20;
+    size_t got;
+
+    printf("async\n");
+    rx_drain();
+    reset_stats();
+    pattern(Tx_data, ASYNC_SIZE + 100, 7);
+
+    // Everything is already in the RX buffer
+    host_rx_send(Tx_data, 50);
+    host_delay_us(frames_ns(60) / 1000);
+    Async_done = false;
+    CHECK(uart_read_async(Async_buf, 40, async_callback));
+    CHECK(Async_done);
+    CHECK(memcmp(Async_buf, Tx_data, 40) == 0);
+    got = rx_collect(Rx_data, 10);
+    CHECK(got == 10);
+    CHECK(memcmp(Rx_data, Tx_data + 40, got) == 0);
+
+    // Part is in the RX buffer, the rest is received straight into Async_buf
+    host_rx_send(Tx_data, head);
+    host_delay_us(frames_ns(head + 4) / 1000);
+    Async_done = false;
+    CHECK(uart_read_async(Async_buf, ASYNC_SIZE, async_callback));
+    CHECK(!Async_done);
+    CHECK(uart_read_async_busy());
+    CHECK(!uart_read_async(other, sizeof(other), async_callback));
+
+    host_rx_send(Tx_data + head, ASYNC_SIZE - head + 100);
+    async_wait(ASYNC_SIZE);
+    CHECK(Async_done);
+    CHECK(!uart_read_async_busy());
+    CHECK(memcmp(Async_buf, Tx_data, ASYNC_SIZE) == 0);
+
+    // What arrived afterwards goes to the RX buffer again
+    got = rx_collect(Rx_data, 100);
+    CHECK(got == 100);
+    CHECK(memcmp(Rx_data, Tx_data + ASYNC_SIZE, got) == 0);
+
+    // Nothing is waiting. Once it completes, the ring restarts at the start of its first block.
+    Async_done = false;
+    CHECK(uart_read_async(Async_buf, 10, async_callback));
+    host_rx_send(Tx_data, 10);
+    async_wait(10);
+    CHECK(Async_done);
+    CHECK(memcmp(Async_buf, Tx_data, 10) == 0);
+
+    // Called with interrupts masked, like from an ISR. A ring block completes, but its interrupt
+    // can't run.
+    cli();
+    host_rx_send(Tx_data, RX_SEG_SIZE);
+    host_delay_us(frames_ns(RX_SEG_SIZE + 4) / 1000);
+    Async_done = false;
+    CHECK(uart_read_async(Async_buf, RX_SEG_SIZE + 20, async_callback));
+    sei();
+    CHECK(!Async_done);
+    host_rx_send(Tx_data + RX_SEG_SIZE, 20);
+    async_wait(20);
+    CHECK(Async_done);
+    CHECK(memcmp(Async_buf, Tx_data, RX_SEG_SIZE + 20) == 0);
+}
+
+//==================================================================================================
+// Main
+//==================================================================================================
+
+int main(int argc, char *argv[]){
+    struct host_config cfg = {
+        .f_cpu = F_CPU,
+        .access_cycles = 8,
+        .isr_cycles = 40,
+        .rts_lag = 2,
+    };
+    uint32_t baud = 0;
+    size_t n = 4096;
+    int opt;
+
+    while((opt = getopt(argc, argv, "b:n:")) != -1){
+        switch(opt){
+            case 'b': baud = strtoul(optarg, NULL, 0); break;
+            case 'n': n = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "Usage: %s [-b baud] [-n bytes]\n", argv[0]);
+                return(2);
+        }
+    }
+    if(n > sizeof(Tx_data)){
+        n = sizeof(Tx_data);
+    }
+
+    #if(RX_FLOW_CONTROL_EN == 1)
+        cfg.rts_port = &RX_FLOW_PORT;
+        cfg.rts_pin = RX_FLOW_PIN;
+    #endif
+    #if(TX_FLOW_CONTROL_EN == 1)
+        cfg.cts_port = &TX_FLOW_PORT;
+        cfg.cts_pin = TX_FLOW_PIN;
+    #endif
+    #if(RS485_EN == 1)
+        cfg.de_port = &RS485_DE_PORT;
+        cfg.de_pin = RS485_DE_PIN;
+    #endif
+
+    host_init(&cfg);
+    event_init();
+    if(HOST_MODE == 2){
+        // As another module may have left it. uart_init() must select the mode it needs.
+        EDMA.CTRL = EDMA_CHMODE_STD02_gc | EDMA_DBUFMODE_BUF0123_gc;
+    }
+    uart_init();
+    if(baud){
+        uart_set_baud(baud);
+    }
+    printf("%s: %lu baud (%lu requested), RX_BUF_SIZE %d, TX_BUF_SIZE %d%s%s%s%s%s\n", MODE_NAME,
+        (unsigned long)host_baud(), (unsigned long)(baud ? baud : BAUD_RATE), RX_BUF_SIZE,
+        TX_BUF_SIZE, RX_FLOW ? ", RTS" : "", TX_FLOW ? ", CTS" : "",
+        (RX_ASYNC_EVENT_EN == 1) ? ", async events" : "", RS485 ? ", RS-485" : "",
+        LINE ? ", lines" : "");
+
+    if(LINE){
+        // The other RX functions can't be used
+        test_tx(n);
+        test_line();
+        goto done;
+    }
+
+    test_rx(n);
+    test_tx(n);
+    if(!RS485){
+        // Needs both directions at once
+        test_echo(n);
+    }
+    test_overrun();
+    if(TX_FLOW){
+        test_cts();
+    }
+    if(RS485){
+        test_rs485();
+    }
+    if(HOST_MODE == 2){
+        test_async();
+    }
+
+done:
+    uart_uninit();
+
+    if(Failures){
+        printf("%u checks FAILED\n", Failures);
+        return(1);
+    }
+    printf("passed\n");
+    return(0);
+}
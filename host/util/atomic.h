@@ -0,0 +1,55 @@
+/**
+* \file
+* \brief Host stand-in for <util/atomic.h>
+* \details Same usage as the avr-libc version. Restoring the interrupt flag goes through hal.c so
+*   that interrupts that became pending inside the block are delivered when it ends.
+**/
+
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#include <stdint.h>
+
+#include "hal.h"
+
+///\cond INTERNAL
+static __inline__ uint8_t host_atomic_cli(void){
+    host_cli();
+    return(1);
+}
+
+static __inline__ uint8_t host_atomic_sei(void){
+    host_sei();
+    return(1);
+}
+
+static __inline__ void host_atomic_restore(const uint8_t *sreg){
+    host_sreg_restore(*sreg);
+}
+
+static __inline__ void host_atomic_force_on(const uint8_t *sreg){
+    (void)sreg;
+    host_sei();
+}
+
+static __inline__ void host_atomic_force_off(const uint8_t *sreg){
+    (void)sreg;
+    host_cli();
+}
+///\endcond
+
+#define ATOMIC_BLOCK(type)      for(type, host_atomic_todo = host_atomic_cli(); \
+                                    host_atomic_todo; host_atomic_todo = 0)
+#define NONATOMIC_BLOCK(type)   for(type, host_atomic_todo = host_atomic_sei(); \
+                                    host_atomic_todo; host_atomic_todo = 0)
+
+#define ATOMIC_RESTORESTATE \
+    uint8_t host_sreg_save __attribute__((__cleanup__(host_atomic_restore))) = host_sreg
+#define ATOMIC_FORCEON \
+    uint8_t host_sreg_save __attribute__((__cleanup__(host_atomic_force_on))) = 0
+#define NONATOMIC_RESTORESTATE \
+    uint8_t host_sreg_save __attribute__((__cleanup__(host_atomic_restore))) = host_sreg
+#define NONATOMIC_FORCEOFF \
+    uint8_t host_sreg_save __attribute__((__cleanup__(host_atomic_force_off))) = 0
+
+#endif
@@ -159,6 +159,49 @@ static uint8_t split_args(char *str, char *argv[]){
     }
 #endif
 
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Split a command line into arguments and execute the command
+**/
+static void cli_execute(char *str){
+    // Split the string into argv table
+    char *argv[CLI_MAX_ARGC];
+    uint8_t argc;
+    
+    argc = split_args(str, argv);
+    
+    if(argc > 0){
+        cmdentry_t *command;
+        
+        #if USE_BINARY_SEARCH
+            // Use binary search to lookup the command
+            cmdentry_t key;
+            key.strCommand = argv[0];
+            command = bsearch(&key, CommandTable, CMDCOUNT, sizeof(cmdentry_t), compare_cmdentry);
+        #else
+            // Linear search to lookup command
+            size_t i;
+            command = NULL;
+            for(i=0;i<CMDCOUNT;i++){
+                if(strcmp(CommandTable[i].strCommand, argv[0]) == 0){
+                    command = (cmdentry_t*)&CommandTable[i];
+                    break;
+                }
+            }
+        #endif
+        if(command){
+            int err;
+            err = (command->cmdptr)(argc,argv); // Execute command
+            
+            if(err){
+                cli_print_error(err);
+            }
+        }else{
+            cli_print_notfound(argv[0]);
+        }
+    }
+}
+
 //--------------------------------------------------------------------------------------------------
 void cli_process_char(char inchar){
     static char strin[CLI_STRBUF_SIZE];
@@ -170,43 +213,7 @@ void cli_process_char(char inchar){
         cli_puts("\r\n");
         
         if(stridx != 0){
-            
-            // Split the string into argv table
-            char *argv[CLI_MAX_ARGC];
-            uint8_t argc;
-            
-            argc = split_args(strin, argv);
-            
-            if(argc > 0){
-                cmdentry_t *command;
-                
-                #if USE_BINARY_SEARCH
-                    // Use binary search to lookup the command
-                    cmdentry_t key;
-                    key.strCommand = argv[0];
-                    command = bsearch(&key, CommandTable, CMDCOUNT, sizeof(cmdentry_t), compare_cmdentry);
-                #else
-                    // Linear search to lookup command
-                    size_t i;
-                    command = NULL;
-                    for(i=0;i<CMDCOUNT;i++){
-                        if(strcmp(CommandTable[i].strCommand, argv[0]) == 0){
-                            command = (cmdentry_t*)&CommandTable[i];
-                            break;
-                        }
-                    }
-                #endif
-                if(command){
-                    int err;
-                    err = (command->cmdptr)(argc,argv); // Execute command
-                    
-                    if(err){
-                        cli_print_error(err);
-                    }
-                }else{
-                    cli_print_notfound(argv[0]);
-                }
-            }
+            cli_execute(strin);
         }
         
         cli_print_prompt();
@@ -227,6 +234,19 @@ void cli_process_char(char inchar){
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+void cli_process_line(char *line){
+    #if CLI_ECHO_LINES
+        // Characters were not echoed while the line was typed
+        if(echo) cli_puts(line);
+    #endif
+    cli_puts("\r\n");
+    
+    cli_execute(line);
+    
+    cli_print_prompt();
+}
+
 //--------------------------------------------------------------------------------------------------
 void cli_echo_off(void){
     echo = false;
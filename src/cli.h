@@ -65,6 +65,16 @@ typedef struct{
 **/
 void cli_process_char(char inchar);
 
+/**
+* \brief Complete line processing function.
+*
+* Alternative to cli_process_char() for input that was already assembled into lines. (e.g. by the
+* line discipline of uart_io) The line is executed. If \c CLI_ECHO_LINES is set, it is echoed as a
+* whole first, for input whose characters were not echoed as they were typed. The string is
+* modified while it is split into arguments.
+**/
+void cli_process_line(char *line);
+
 void cli_puts(char *str);
 void cli_putc(char chr);
 void cli_print_prompt(void);
@@ -1,19 +1,23 @@
 
-#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
 #include "cli_commands.h"
 
 //==================================================================================================
 // Device-specific output functions
 //==================================================================================================
 
-#include <stdio.h>
+#include "uart_io.h"
+#include "uart_io_ext.h"
+#include "string_ext.h"
 
 void cli_puts(char *str){
-    printf(str); // Example using stdio.h
+    uart_puts(str); // Example using uart_io
 }
 
 void cli_putc(char chr){
-    putchar(chr); // Example using stdio.h
+    uart_putc(chr); // Example using uart_io
 }
 
 void cli_print_prompt(void){
@@ -21,7 +25,7 @@ void cli_print_prompt(void){
 }
 
 void cli_print_error(int error){
-    printf("Returned with error code %d\r\n", error); // Example using stdio.h
+    uart_printf("Returned with error code %d\r\n", error); // Example using uart_io_ext
 }
 
 void cli_print_notfound(char *strcmd){
@@ -49,3 +53,52 @@ int cmd_ArgList(uint8_t argc, char *argv[]){
     return(0);
 }
 
+//--------------------------------------------------------------------------------------------------
+// Parse an argument that must be a complete signed number
+static bool arg_to_int32(char *arg, int32_t *num){
+    uint8_t len = scan_sd32(arg, num);
+    return((len != 0) && (arg[len] == 0));
+}
+
+int cmd_Add(uint8_t argc, char *argv[]){
+    int32_t a, b;
+    
+    if(argc != 3) return(1);
+    if(!arg_to_int32(argv[1], &a) || !arg_to_int32(argv[2], &b)) return(2);
+    
+    // Signed overflow is undefined. Reject sums that don't fit.
+    if((b > 0) ? (a > INT32_MAX - b) : (a < INT32_MIN - b)) return(3);
+    
+    uart_printf("%ld\r\n", a + b);
+    return(0);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Parse an argument that must be a complete hex number
+static bool arg_to_hex32(char *arg, uint32_t *num){
+    uint8_t len = scan_x32(arg, num);
+    return((len != 0) && (arg[len] == 0));
+}
+
+// dump <ram|flash|eeprom> <hex address> <hex length>
+int cmd_Dump(uint8_t argc, char *argv[]){
+    hexdump_read_t read;
+    uint32_t addr, len;
+    
+    if(argc != 4) return(1);
+    
+    if(strcmp(argv[1], "ram") == 0){
+        read = hexdump_read_ram;
+    }else if(strcmp(argv[1], "flash") == 0){
+        read = hexdump_read_flash;
+    }else if(strcmp(argv[1], "eeprom") == 0){
+        read = hexdump_read_eeprom;
+    }else{
+        return(2);
+    }
+    
+    if(!arg_to_hex32(argv[2], &addr) || !arg_to_hex32(argv[3], &len)) return(2);
+    
+    uart_hexdump(addr, len, read);
+    return(0);
+}
@@ -10,6 +10,10 @@
 // If set to 1, performs command lookup using a binary search instead of linear.
 #define USE_BINARY_SEARCH   0
 
+// If set to 1, cli_process_line() echoes the whole line before executing it. (e.g. for lines from
+// the uart_io line discipline, which does not echo characters as they are typed)
+#define CLI_ECHO_LINES  0
+
 // maximum length of a command input line
 #define CLI_STRBUF_SIZE    64
 
@@ -18,11 +22,15 @@
 
 // Table of commands: {"command_word" , function_name }
 // Command words MUST be in alphabetical (ascii) order!! (A-Z then a-z) if using binary search
-#define CMDTABLE    {"args"  , cmd_ArgList  },\
+#define CMDTABLE    {"add"   , cmd_Add      },\
+                    {"args"  , cmd_ArgList  },\
+                    {"dump"  , cmd_Dump     },\
                     {"hi"    , cmd_Hello    }
 
 // Custom command function prototypes:
+int cmd_Add(uint8_t argc, char *argv[]);
 int cmd_ArgList(uint8_t argc, char *argv[]);
+int cmd_Dump(uint8_t argc, char *argv[]);
 int cmd_Hello(uint8_t argc, char *argv[]);
 
 #endif
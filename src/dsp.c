@@ -0,0 +1,175 @@
+/**
+* \file
+* \brief Fixed-point DSP kernels
+**/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fixedpt.h"
+#include "dsp.h"
+
+//==================================================================================================
+// FIR Filter
+//==================================================================================================
+///\cond INTERNAL
+
+/* Each sample is stored twice in the delay line, num_taps apart. The last num_taps samples are then
+ * always contiguous, starting at the newest one, so the tap loop needs no wraparound checks.
+ */
+
+static __inline__ void fir_push(dsp_fir_t *fir, q15_t x){
+    if(fir->idx == 0){
+        fir->idx = fir->num_taps;
+    }
+    fir->idx--;
+    fir->state[fir->idx] = x;
+    fir->state[fir->idx + fir->num_taps] = x;
+}
+
+//--------------------------------------------------------------------------------------------------
+static __inline__ q15_t fir_output(dsp_fir_t *fir){
+    const q15_t *h = fir->coeffs;
+    const q15_t *s = fir->state + fir->idx;
+    uint8_t n = fir->num_taps;
+    int32_t acc = 0;
+    
+    while(n){
+        acc = mac_Q15(acc, *h++, *s++);
+        n--;
+    }
+    
+    return(Q30_to_Q15(acc));
+}
+
+///\endcond
+
+//--------------------------------------------------------------------------------------------------
+void dsp_fir_init(dsp_fir_t *fir, const q15_t *coeffs, q15_t *state, uint8_t num_taps){
+    fir->coeffs = coeffs;
+    fir->state = state;
+    fir->num_taps = num_taps;
+    fir->idx = 0;
+    memset(state, 0, 2 * num_taps * sizeof(q15_t));
+}
+
+//--------------------------------------------------------------------------------------------------
+void dsp_fir(dsp_fir_t *fir, const q15_t *src, q15_t *dst, size_t count){
+    while(count){
+        fir_push(fir, *src++);
+        *dst++ = fir_output(fir);
+        count--;
+    }
+}
+
+//==================================================================================================
+// Biquad IIR Filter
+//==================================================================================================
+
+void dsp_biquad_init(dsp_biquad_t *iir, const dsp_biquad_coeffs_t *coeffs,
+                     dsp_biquad_state_t *state, uint8_t num_stages){
+    iir->coeffs = coeffs;
+    iir->state = state;
+    iir->num_stages = num_stages;
+    memset(state, 0, num_stages * sizeof(dsp_biquad_state_t));
+}
+
+//--------------------------------------------------------------------------------------------------
+void dsp_biquad(dsp_biquad_t *iir, const q15_t *src, q15_t *dst, size_t count){
+    const dsp_biquad_coeffs_t *c;
+    dsp_biquad_state_t *s;
+    uint8_t stage;
+    int32_t acc;
+    q15_t x;
+    
+    while(count){
+        x = *src++;
+        c = iir->coeffs;
+        s = iir->state;
+        for(stage = iir->num_stages; stage; stage--){
+            // Q14 coefficients * Q15 samples = Q29
+            acc = mac_Q15(0, c->b0, x);
+            acc = mac_Q15(acc, c->b1, s->x1);
+            acc = mac_Q15(acc, c->b2, s->x2);
+            acc = mac_Q15(acc, c->a1, s->y1);
+            acc = mac_Q15(acc, c->a2, s->y2);
+            
+            s->x2 = s->x1;
+            s->x1 = x;
+            
+            // Q29 to Q15, rounded
+            x = sat_Q15((acc >> 14) + ((acc >> 13) & 1));
+            
+            s->y2 = s->y1;
+            s->y1 = x;
+            c++;
+            s++;
+        }
+        *dst++ = x;
+        count--;
+    }
+}
+
+//==================================================================================================
+// Moving Average
+//==================================================================================================
+
+void dsp_movavg_init(dsp_movavg_t *avg, q15_t *window, uint8_t len){
+    avg->window = window;
+    // Offset the sum so it is never negative, and bias it by half an output LSB so that the
+    // flooring multiply rounds to nearest
+    avg->sum = (uint32_t)len * 32768 + (len >> 1);
+    avg->len = len;
+    avg->idx = 0;
+    // 2^32/len, rounded up. The floor of sum*scale is then exactly floor(sum/len) for any sum the
+    // window can hold.
+    avg->scale = UINT32_MAX / len + 1;
+    memset(window, 0, len * sizeof(q15_t));
+}
+
+//--------------------------------------------------------------------------------------------------
+void dsp_movavg(dsp_movavg_t *avg, const q15_t *src, q15_t *dst, size_t count){
+    q15_t x;
+    
+    while(count){
+        x = *src++;
+        avg->sum += x - avg->window[avg->idx];
+        avg->window[avg->idx] = x;
+        avg->idx++;
+        if(avg->idx == avg->len){
+            avg->idx = 0;
+        }
+        *dst++ = (int16_t)(mpy_Q32(avg->sum, avg->scale) - 32768);
+        count--;
+    }
+}
+
+//==================================================================================================
+// Decimation
+//==================================================================================================
+
+void dsp_decim_init(dsp_decim_t *dec, const q15_t *coeffs, q15_t *state, uint8_t num_taps,
+                    uint8_t factor){
+    dsp_fir_init(&dec->fir, coeffs, state, num_taps);
+    dec->factor = factor;
+    dec->phase = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+size_t dsp_decimate(dsp_decim_t *dec, const q15_t *src, q15_t *dst, size_t count){
+    size_t n = 0;
+    
+    while(count){
+        fir_push(&dec->fir, *src++);
+        dec->phase++;
+        if(dec->phase == dec->factor){
+            dec->phase = 0;
+            // dst never passes src, so this works in place
+            dst[n++] = fir_output(&dec->fir);
+        }
+        count--;
+    }
+    
+    return(n);
+}
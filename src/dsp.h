@@ -0,0 +1,193 @@
+/**
+* \file
+* \brief Include file for the fixed-point DSP kernels
+*
+* Block-processing filters for Q15 samples. Each function takes a source and destination array
+* which may be the same array, so samples can be filtered in place. This includes the read span
+* of a FIFO:
+* \code
+* uint8_t *span;
+* size_t n = fifo_rdspan(&adc_fifo, &span) / sizeof(q15_t);
+* dsp_fir(&fir, (q15_t*)span, (q15_t*)span, n);
+* \endcode
+* The FIFO's buffer size must be a multiple of \c sizeof(q15_t) so samples don't straddle the wrap.
+*
+* Cost per output sample is dominated by mac_Q15(), which is 24 cycles on AVR:
+* - FIR: one mac_Q15() per tap
+* - Biquad: five mac_Q15() per stage
+* - Moving average: one add, one subtract and one mpy_Q32()
+* - Decimation: one mac_Q15() per tap, for every \c factor input samples
+**/
+
+#ifndef DSP_H
+#define DSP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fixedpt.h"
+
+//==================================================================================================
+// FIR Filter
+//==================================================================================================
+
+/**
+ * \brief FIR filter object
+ **/
+typedef struct {
+    const q15_t *coeffs;    ///< Filter coefficients. coeffs[0] applies to the newest sample
+    q15_t *state;           ///< Delay line. 2 * num_taps samples
+    uint8_t num_taps;       ///< Number of coefficients
+    uint8_t idx;            ///< Position of the newest sample in the delay line
+} dsp_fir_t;
+
+/**
+* \brief Initialize an FIR filter
+* \details The sum of the absolute values of the coefficients must be less than 2.0 to avoid
+*   overflowing the accumulator.
+* \param fir Pointer to the filter object
+* \param coeffs Array of \c num_taps coefficients. Must remain allocated
+* \param state Array of 2 * \c num_taps samples used as the delay line. Must remain allocated
+* \param num_taps Number of coefficients
+**/
+void dsp_fir_init(dsp_fir_t *fir, const q15_t *coeffs, q15_t *state, uint8_t num_taps);
+
+/**
+* \brief Run samples through an FIR filter
+* \param fir Pointer to the filter object
+* \param src Input samples
+* \param dst Output samples. May be the same as \c src
+* \param count Number of samples
+**/
+void dsp_fir(dsp_fir_t *fir, const q15_t *src, q15_t *dst, size_t count);
+
+//==================================================================================================
+// Biquad IIR Filter
+//==================================================================================================
+
+/**
+ * \brief Coefficients of one biquad stage, in Q14 (-2.0 to 2.0)
+ * \details y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] + a1*y[n-1] + a2*y[n-2]
+ *   Note that a1 and a2 are added, so they are the negated feedback coefficients of the usual
+ *   transfer function.
+ **/
+typedef struct {
+    q15_t b0, b1, b2;
+    q15_t a1, a2;
+} dsp_biquad_coeffs_t;
+
+/**
+ * \brief State of one biquad stage
+ **/
+typedef struct {
+    q15_t x1, x2;
+    q15_t y1, y2;
+} dsp_biquad_state_t;
+
+/**
+ * \brief Cascaded biquad filter object
+ **/
+typedef struct {
+    const dsp_biquad_coeffs_t *coeffs;  ///< Coefficients of each stage
+    dsp_biquad_state_t *state;          ///< State of each stage
+    uint8_t num_stages;                 ///< Number of stages
+} dsp_biquad_t;
+
+/**
+* \brief Initialize a cascaded biquad filter
+* \param iir Pointer to the filter object
+* \param coeffs Array of \c num_stages coefficient sets. Must remain allocated
+* \param state Array of \c num_stages states. Must remain allocated
+* \param num_stages Number of stages
+**/
+void dsp_biquad_init(dsp_biquad_t *iir, const dsp_biquad_coeffs_t *coeffs,
+                     dsp_biquad_state_t *state, uint8_t num_stages);
+
+/**
+* \brief Run samples through a cascaded biquad filter
+* \details Each stage's output is rounded and saturated to Q15 before it is passed on.
+* \param iir Pointer to the filter object
+* \param src Input samples
+* \param dst Output samples. May be the same as \c src
+* \param count Number of samples
+**/
+void dsp_biquad(dsp_biquad_t *iir, const q15_t *src, q15_t *dst, size_t count);
+
+//==================================================================================================
+// Moving Average
+//==================================================================================================
+
+/**
+ * \brief Moving average object
+ **/
+typedef struct {
+    q15_t *window;      ///< Last \c len samples
+    uint32_t sum;       ///< Sum of the samples in the window + 32768*len + len/2
+    uint32_t scale;     ///< 1/len in Q0.32, rounded up
+    uint8_t len;        ///< Number of samples averaged
+    uint8_t idx;        ///< Position of the oldest sample in the window
+} dsp_movavg_t;
+
+/**
+* \brief Initialize a moving average
+* \details The window starts out filled with zeros.
+* \param avg Pointer to the moving average object
+* \param window Array of \c len samples. Must remain allocated
+* \param len Number of samples to average. (2 to 255)
+**/
+void dsp_movavg_init(dsp_movavg_t *avg, q15_t *window, uint8_t len);
+
+/**
+* \brief Run samples through a moving average
+* \details Outputs are rounded to nearest, so a constant input is passed through unchanged.
+* \param avg Pointer to the moving average object
+* \param src Input samples
+* \param dst Output samples. May be the same as \c src
+* \param count Number of samples
+**/
+void dsp_movavg(dsp_movavg_t *avg, const q15_t *src, q15_t *dst, size_t count);
+
+//==================================================================================================
+// Decimation
+//==================================================================================================
+
+/**
+ * \brief Decimator object
+ **/
+typedef struct {
+    dsp_fir_t fir;      ///< Anti-aliasing filter
+    uint8_t factor;     ///< Decimation factor
+    uint8_t phase;      ///< Number of samples received since the last output
+} dsp_decim_t;
+
+/**
+* \brief Initialize a decimator
+* \param dec Pointer to the decimator object
+* \param coeffs Anti-aliasing FIR filter. Same as dsp_fir_init()
+* \param state Delay line of 2 * \c num_taps samples. Same as dsp_fir_init()
+* \param num_taps Number of FIR coefficients
+* \param factor Keep one out of every \c factor samples
+**/
+void dsp_decim_init(dsp_decim_t *dec, const q15_t *coeffs, q15_t *state, uint8_t num_taps,
+                    uint8_t factor);
+
+/**
+* \brief Filter and decimate samples
+* \details The filter is only evaluated for the samples that are kept.
+* \param dec Pointer to the decimator object
+* \param src Input samples
+* \param dst Output samples. May be the same as \c src
+* \param count Number of input samples
+* \return Number of output samples
+**/
+size_t dsp_decimate(dsp_decim_t *dec, const q15_t *src, q15_t *dst, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -48,6 +48,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <util/atomic.h>
 
 #include "fifo.h"
 #include "event_queue.h"
@@ -105,17 +106,20 @@ void event_init(void){
 //--------------------------------------------------------------------------------------------------
 
 int event_PushEvent(void (*fptr)(void), void *eventData, size_t size){
-    if(fifo_wrcount(&EventFIFO) >= (sizeof(fptr)+size)){
-        // Enough room in Event Queue. Write event.
-        fifo_write(&EventFIFO,&fptr,sizeof(fptr));
-        if(size != 0){
-            fifo_write(&EventFIFO,eventData,size);
+    // An interrupt that pushes an event must not land between fptr and its data
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(fifo_wrcount(&EventFIFO) >= (sizeof(fptr)+size)){
+            // Enough room in Event Queue. Write event.
+            fifo_write(&EventFIFO,&fptr,sizeof(fptr));
+            if(size != 0){
+                fifo_write(&EventFIFO,eventData,size);
+            }
+            return(0);
         }
-        return(0);
-    }else{
-        // Not enough room in event queue.
-        return(-1);
     }
+    
+    // Not enough room in event queue.
+    return(-1);
 }
 
 //--------------------------------------------------------------------------------------------------
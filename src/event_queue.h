@@ -122,6 +122,8 @@ void event_StartHandler(void);
 *    values. If pusing additional data with the event, the event called \e MUST have a matching
 *    event_PopEventData(). Every additional byte pushed into the event queue \e MUST be popped out
 *    regardless if it is used or not.
+* 
+*    Safe to call from an interrupt. The event and its data are written with interrupts disabled.
 **/
 int event_PushEvent(void (*fptr)(void), void *eventData, size_t size);
 
@@ -243,6 +243,69 @@ int fifo_peek(FIFO_t *fifo, void *dst, size_t size){
     return(0);
 }
 
+//--------------------------------------------------------------------------------------------------
+size_t fifo_wrspan(FIFO_t *fifo, uint8_t **ptr){
+    size_t wridx,rdidx;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        wridx = fifo->wridx;
+        rdidx = fifo->rdidx;
+    }
+    
+    *ptr = fifo->bufptr + wridx;
+    
+    if(rdidx > wridx){
+        return(rdidx-wridx-1);
+    }else if(rdidx == 0){
+        // One byte is always left empty
+        return(fifo->bufsize-wridx-1);
+    }else{
+        return(fifo->bufsize-wridx);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void fifo_wrcommit(FIFO_t *fifo, size_t size){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        fifo->wridx += size;
+        if(fifo->wridx >= fifo->bufsize){
+            fifo->wridx -= fifo->bufsize;
+        }
+        
+        #if(FIFO_LOG_MAX_USAGE == 1)
+            size = fifo_rdcount(fifo);
+            if(size > fifo->max){
+                fifo->max = size;
+            }
+        #endif
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+size_t fifo_rdspan(FIFO_t *fifo, uint8_t **ptr){
+    size_t wridx,rdidx;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        wridx = fifo->wridx;
+        rdidx = fifo->rdidx;
+    }
+    
+    *ptr = fifo->bufptr + rdidx;
+    if(wridx >= rdidx){
+        return(wridx-rdidx);
+    }else{
+        return(fifo->bufsize-rdidx);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void fifo_rdcommit(FIFO_t *fifo, size_t size){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        fifo->rdidx += size;
+        if(fifo->rdidx >= fifo->bufsize){
+            fifo->rdidx -= fifo->bufsize;
+        }
+    }
+}
+
 //--------------------------------------------------------------------------------------------------
 void fifo_clear(FIFO_t *fifo){
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
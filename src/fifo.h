@@ -145,6 +145,122 @@ size_t fifo_rdcount(FIFO_t *fifo); // Returns the number of bytes currently stor
 **/
 size_t fifo_wrcount(FIFO_t *fifo); // Returns the number of bytes free in the FIFO
 
+/**
+* \brief Get the contiguous free space at the write pointer
+* \details Allows data to be written directly into the FIFO's buffer. Once written, the data is
+*   added to the FIFO using fifo_wrcommit(). Only one writer may use this at a time.
+* \param [in] fifo Pointer to the #FIFO_t object
+* \param [out] ptr Pointer to the free space
+* \return Number of bytes that can be written to \c ptr
+**/
+size_t fifo_wrspan(FIFO_t *fifo, uint8_t **ptr);
+
+/**
+* \brief Add data that was written into the span returned by fifo_wrspan()
+* \param [in] fifo Pointer to the #FIFO_t object
+* \param [in] size Number of bytes written. Must not exceed the size of the span.
+**/
+void fifo_wrcommit(FIFO_t *fifo, size_t size);
+
+/**
+* \brief Get the contiguous data at the read pointer
+* \details Allows data to be read (or modified in place) directly in the FIFO's buffer. Once done,
+*   the data is removed from the FIFO using fifo_rdcommit(). Only one reader may use this at a time.
+* \param [in] fifo Pointer to the #FIFO_t object
+* \param [out] ptr Pointer to the data
+* \return Number of bytes that can be read from \c ptr
+**/
+size_t fifo_rdspan(FIFO_t *fifo, uint8_t **ptr);
+
+/**
+* \brief Remove data that was read from the span returned by fifo_rdspan()
+* \param [in] fifo Pointer to the #FIFO_t object
+* \param [in] size Number of bytes read. Must not exceed the size of the span.
+**/
+void fifo_rdcommit(FIFO_t *fifo, size_t size);
+
+//==================================================================================================
+// ISR Fast Path
+//==================================================================================================
+/* Single-byte inline accessors for use inside the interrupt that owns one end of a FIFO.
+ * They skip the memcpy and ATOMIC_BLOCK overhead of the functions above.
+ *
+ * These are only safe if the caller can not be interrupted by anything else that accesses the
+ * same FIFO. (ie: The other end is only accessed from the main program using the interrupt-safe
+ * functions above)
+ */
+
+/**
+* \brief Get the number of bytes available for read. ISR-only version of fifo_rdcount()
+* \param [in] fifo Pointer to the #FIFO_t object
+* \return Number of bytes
+**/
+static __inline__ size_t fifo_isr_rdcount(FIFO_t *fifo){
+    size_t wridx = fifo->wridx;
+    size_t rdidx = fifo->rdidx;
+    
+    if(wridx >= rdidx){
+        return(wridx-rdidx);
+    }else{
+        return((fifo->bufsize-rdidx)+wridx);
+    }
+}
+
+/**
+* \brief Write a single byte into the FIFO. ISR-only
+* \param [in] fifo Pointer to the #FIFO_t object
+* \param [in] c Byte to be written
+* \retval 0 OK
+* \retval -1 FIFO is full
+**/
+static __inline__ int fifo_isr_putc(FIFO_t *fifo, uint8_t c){
+    size_t wridx = fifo->wridx;
+    size_t next = wridx + 1;
+    
+    if(next == fifo->bufsize){
+        next = 0;
+    }
+    if(next == fifo->rdidx){
+        return(-1);
+    }
+    
+    fifo->bufptr[wridx] = c;
+    fifo->wridx = next;
+    
+    #if(FIFO_LOG_MAX_USAGE == 1)
+        wridx = fifo_isr_rdcount(fifo);
+        if(wridx > fifo->max){
+            fifo->max = wridx;
+        }
+    #endif
+    
+    return(0);
+}
+
+/**
+* \brief Read a single byte from the FIFO. ISR-only
+* \param [in] fifo Pointer to the #FIFO_t object
+* \param [out] c Destination of the byte
+* \retval 0 OK
+* \retval -1 FIFO is empty
+**/
+static __inline__ int fifo_isr_getc(FIFO_t *fifo, uint8_t *c){
+    size_t rdidx = fifo->rdidx;
+    
+    if(rdidx == fifo->wridx){
+        return(-1);
+    }
+    
+    *c = fifo->bufptr[rdidx];
+    rdidx++;
+    if(rdidx == fifo->bufsize){
+        rdidx = 0;
+    }
+    fifo->rdidx = rdidx;
+    
+    return(0);
+}
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,481 @@
+/**
+* \file
+* \brief Fixed-point functions that are too large to inline
+* \details No 64-bit math or library division is used.
+**/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <avr/pgmspace.h>
+
+#include "fixedpt.h"
+
+#include <fixedpt_config.h>
+
+#if (FIXEDPT_SIN_TABLE_BITS < 4) || (FIXEDPT_SIN_TABLE_BITS > 8)
+    #error "FIXEDPT_SIN_TABLE_BITS must be between 4 and 8"
+#endif
+#if (FIXEDPT_LOG2_TABLE_BITS < 4) || (FIXEDPT_LOG2_TABLE_BITS > 8)
+    #error "FIXEDPT_LOG2_TABLE_BITS must be between 4 and 8"
+#endif
+#if (FIXEDPT_EXP2_TABLE_BITS < 4) || (FIXEDPT_EXP2_TABLE_BITS > 8)
+    #error "FIXEDPT_EXP2_TABLE_BITS must be between 4 and 8"
+#endif
+
+//==================================================================================================
+// Internal Functions
+//==================================================================================================
+///\cond INTERNAL
+
+/**
+* \brief Fractional divide using shift and subtract
+* \param n Numerator. Must be <= d
+* \param d Denominator. Must not be 0. Up to 2^31
+* \param bits Number of quotient bits
+* \return round((n << bits) / d). Can be 2^bits if n/d rounds to 1.
+**/
+static uint32_t frac_div(uint32_t n, uint32_t d, uint8_t bits){
+    uint32_t q = 0;
+    
+    while(bits){
+        n <<= 1;
+        q <<= 1;
+        if(n >= d){
+            n -= d;
+            q |= 1;
+        }
+        bits--;
+    }
+    
+    // Round using the remainder
+    if((n << 1) >= d) q++;
+    
+    return(q);
+}
+
+//==================================================================================================
+// Lookup Tables
+//==================================================================================================
+/* Table entries are evaluated by the compiler from series that are accurate to well beyond 16 bits,
+ * so the table size can be changed in fixedpt_config.h without regenerating anything.
+ * TBL_GEN(E, N) expands to E(0), E(1), ... E(2^N).
+ */
+
+#define TBL_REP4(E,k)   E(k), E((k)+1), E((k)+2), E((k)+3)
+#define TBL_REP16(E,k)  TBL_REP4(E,k), TBL_REP4(E,(k)+4), TBL_REP4(E,(k)+8), TBL_REP4(E,(k)+12)
+#define TBL_REP32(E,k)  TBL_REP16(E,k), TBL_REP16(E,(k)+16)
+#define TBL_REP64(E,k)  TBL_REP32(E,k), TBL_REP32(E,(k)+32)
+#define TBL_REP128(E,k) TBL_REP64(E,k), TBL_REP64(E,(k)+64)
+#define TBL_REP256(E,k) TBL_REP128(E,k), TBL_REP128(E,(k)+128)
+
+#define TBL_BITS_4(E)   TBL_REP16(E,0), E(16)
+#define TBL_BITS_5(E)   TBL_REP32(E,0), E(32)
+#define TBL_BITS_6(E)   TBL_REP64(E,0), E(64)
+#define TBL_BITS_7(E)   TBL_REP128(E,0), E(128)
+#define TBL_BITS_8(E)   TBL_REP256(E,0), E(256)
+
+#define TBL_GEN_(E,N)   TBL_BITS_##N(E)
+#define TBL_GEN(E,N)    TBL_GEN_(E,N)
+
+// sin(t) for t in [0, pi/2]. Taylor series to t^15
+#define SIN_POLY(t,t2)  ((t)*(1-(t2)/6*(1-(t2)/20*(1-(t2)/42*(1-(t2)/72*(1-(t2)/110*(1-(t2)/156 \
+                        *(1-(t2)/210))))))))
+#define SIN_T(k)        ((k) * (1.5707963267948966 / (1 << FIXEDPT_SIN_TABLE_BITS)))
+#define SIN_ENTRY(k)    ((uint16_t)(SIN_POLY(SIN_T(k), SIN_T(k)*SIN_T(k)) * 32768.0 + 0.5))
+
+// log2(1+f) - f for f in [0, 1], in Q18. ln(1+f) = 2*atanh(s) where s = f/(2+f) <= 1/3
+#define LOG2_S(f)       ((f) / (2.0 + (f)))
+#define LOG2_POLY(s,s2) (2.8853900817779268*(s)*(1+(s2)*(1.0/3+(s2)*(1.0/5+(s2)*(1.0/7+(s2) \
+                        *(1.0/9+(s2)*(1.0/11+(s2)*(1.0/13+(s2)*(1.0/15+(s2)*(1.0/17+(s2) \
+                        *(1.0/19+(s2)/21)))))))))))
+#define LOG2_F(k)       ((double)(k) / (1 << FIXEDPT_LOG2_TABLE_BITS))
+#define LOG2_ENTRY(k)   ((uint16_t)((LOG2_POLY(LOG2_S(LOG2_F(k)), LOG2_S(LOG2_F(k))*LOG2_S(LOG2_F(k))) \
+                        - LOG2_F(k)) * 262144.0 + 0.5))
+
+// 1 + f - 2^f for f in [0, 1], in Q18. 2^f = e^u where u = f*ln(2). Taylor series to u^13
+#define EXP2_POLY(u)    (1+(u)*(1+(u)/2*(1+(u)/3*(1+(u)/4*(1+(u)/5*(1+(u)/6*(1+(u)/7*(1+(u)/8 \
+                        *(1+(u)/9*(1+(u)/10*(1+(u)/11*(1+(u)/12*(1+(u)/13)))))))))))))
+#define EXP2_F(k)       ((double)(k) / (1 << FIXEDPT_EXP2_TABLE_BITS))
+#define EXP2_ENTRY(k)   ((uint16_t)((1 + EXP2_F(k) - EXP2_POLY(EXP2_F(k)*0.6931471805599453)) \
+                        * 262144.0 + 0.5))
+
+/// Quarter wave sine in Q15. The last entry is 1.0 (32768)
+static const uint16_t Sin_table[] PROGMEM = {TBL_GEN(SIN_ENTRY, FIXEDPT_SIN_TABLE_BITS)};
+
+/// Deviation of log2(1+f) from a straight line, in Q18
+static const uint16_t Log2_table[] PROGMEM = {TBL_GEN(LOG2_ENTRY, FIXEDPT_LOG2_TABLE_BITS)};
+
+/// Deviation of 2^f from a straight line, in Q18
+static const uint16_t Exp2_table[] PROGMEM = {TBL_GEN(EXP2_ENTRY, FIXEDPT_EXP2_TABLE_BITS)};
+
+/// CORDIC angles atan(2^-i), where 2^32 is a full turn
+static const uint32_t Atan_table[] PROGMEM = {
+    0x20000000, 0x12E4051E, 0x09FB385B, 0x051111D4,
+    0x028B0D43, 0x0145D7E1, 0x00A2F61E, 0x00517C55,
+    0x0028BE53, 0x00145F2F, 0x000A2F98, 0x000517CC,
+    0x00028BE6, 0x000145F3, 0x0000A2FA, 0x0000517D
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Interpolate between two table entries
+* \param table Table in PROGMEM
+* \param x Position in the table. Upper \c bits select the entry, the rest are the fraction
+* \param bits Number of index bits
+* \param xbits Total number of bits in \c x
+**/
+static uint16_t tbl_interp(const uint16_t *table, uint16_t x, uint8_t bits, uint8_t xbits){
+    uint8_t shift = xbits - bits;
+    uint16_t idx = x >> shift;
+    uint16_t frac = x & ((1 << shift) - 1);
+    uint16_t y0 = pgm_read_word(&table[idx]);
+    uint16_t y1;
+    
+    if(frac == 0) return(y0);
+    y1 = pgm_read_word(&table[idx+1]);
+    
+    return(y0 + ((((int32_t)y1 - y0) * frac + (1 << (shift-1))) >> shift));
+}
+
+//==================================================================================================
+// Block Kernels
+//==================================================================================================
+
+/// Upper 16 bits of an unsigned 16x16 product. Same as mpy_Q16()
+static __inline__ uint16_t umulhi16(uint16_t x, uint16_t q){
+    #if defined(__AVR_HAVE_MUL__)
+        uint16_t r;
+        uint8_t mid;
+        uint8_t zero;
+        
+        // The lowest byte of the product is never needed
+        __asm__(
+            "clr    %[z]                \n\t"
+            "mul    %B[x], %B[q]        \n\t" // xh * qh
+            "movw   %A[r], r0           \n\t"
+            "mul    %A[x], %A[q]        \n\t" // xl * ql
+            "mov    %[m], r1            \n\t"
+            "mul    %B[x], %A[q]        \n\t" // xh * ql
+            "add    %[m], r0            \n\t"
+            "adc    %A[r], r1           \n\t"
+            "adc    %B[r], %[z]         \n\t"
+            "mul    %B[q], %A[x]        \n\t" // qh * xl
+            "add    %[m], r0            \n\t"
+            "adc    %A[r], r1           \n\t"
+            "adc    %B[r], %[z]         \n\t"
+            "clr    __zero_reg__        \n\t"
+            : [r] "=&r" (r), [m] "=&r" (mid), [z] "=&r" (zero)
+            : [x] "r" (x), [q] "r" (q)
+        );
+        return(r);
+    #else
+        return(mpy_Q16(x, q));
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+/// Upper 16 bits of a signed by unsigned 16x16 product. Same as mpys_Q16()
+static __inline__ int16_t smulhi16(int16_t x, uint16_t q){
+    #if defined(__AVR_HAVE_MUL__)
+        int16_t r;
+        uint8_t mid;
+        uint8_t zero;
+        
+        __asm__(
+            "clr    %[z]                \n\t"
+            "mulsu  %B[x], %B[q]        \n\t" // xh * qh
+            "movw   %A[r], r0           \n\t"
+            "mul    %A[x], %A[q]        \n\t" // xl * ql
+            "mov    %[m], r1            \n\t"
+            "mulsu  %B[x], %A[q]        \n\t" // xh * ql
+            "sbc    %B[r], %[z]         \n\t"
+            "add    %[m], r0            \n\t"
+            "adc    %A[r], r1           \n\t"
+            "adc    %B[r], %[z]         \n\t"
+            "mul    %B[q], %A[x]        \n\t" // qh * xl
+            "add    %[m], r0            \n\t"
+            "adc    %A[r], r1           \n\t"
+            "adc    %B[r], %[z]         \n\t"
+            "clr    __zero_reg__        \n\t"
+            : [r] "=&r" (r), [m] "=&r" (mid), [z] "=&r" (zero)
+            : [x] "a" (x), [q] "a" (q)
+        );
+        return(r);
+    #else
+        return(mpys_Q16(x, q));
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+/* Runs stmt n times, four per loop iteration. This halves the loop overhead per element compared
+ * to unrolling by 2, and the remainder costs at most 3 extra iterations.
+ */
+#define UNROLL4(n, stmt) \
+    while((n) >= 4){ stmt; stmt; stmt; stmt; (n) -= 4; } \
+    while(n){ stmt; (n)--; }
+
+///\endcond
+
+//==================================================================================================
+// Functions
+//==================================================================================================
+
+q31_t mul_Q31(q31_t a, q31_t b){
+    int16_t ah = a >> 16;
+    int16_t bh = b >> 16;
+    uint16_t al = a;
+    uint16_t bl = b;
+    int32_t hl;
+    int32_t lh;
+    uint32_t ll;
+    uint32_t mid;
+    int32_t hi;
+    uint32_t lo;
+    
+    if((a == INT32_MIN) && (b == INT32_MIN)) return(INT32_MAX);
+    
+    // Build the 64-bit product as hi:lo from 16x16 partial products
+    hl = (int32_t)ah * bl;
+    lh = (int32_t)bh * al;
+    ll = (uint32_t)al * bl;
+    mid = (hl & 0xFFFF) + (lh & 0xFFFF) + (ll >> 16);
+    hi = (int32_t)ah * bh + (hl >> 16) + (lh >> 16) + (int32_t)(mid >> 16);
+    lo = (mid << 16) | (ll & 0xFFFF);
+    
+    // Q62 to Q31. Round using bit 30
+    return((int32_t)(((uint32_t)hi << 1) | (lo >> 31)) + ((lo >> 30) & 1));
+}
+
+//--------------------------------------------------------------------------------------------------
+q15_t div_Q15(q15_t num, q15_t den){
+    bool neg = ((num < 0) != (den < 0));
+    uint16_t n = (num < 0) ? (uint16_t)-num : (uint16_t)num;
+    uint16_t d = (den < 0) ? (uint16_t)-den : (uint16_t)den;
+    uint16_t q;
+    
+    if(n >= d){
+        // |result| >= 1.0
+        return(neg ? INT16_MIN : INT16_MAX);
+    }
+    
+    q = frac_div(n, d, 15);
+    if(neg) return(-(int32_t)q);
+    if(q > INT16_MAX) return(INT16_MAX);
+    return(q);
+}
+
+//--------------------------------------------------------------------------------------------------
+q31_t div_Q31(q31_t num, q31_t den){
+    bool neg = ((num < 0) != (den < 0));
+    uint32_t n = (num < 0) ? -(uint32_t)num : (uint32_t)num;
+    uint32_t d = (den < 0) ? -(uint32_t)den : (uint32_t)den;
+    uint32_t q;
+    
+    if(n >= d){
+        // |result| >= 1.0
+        return(neg ? INT32_MIN : INT32_MAX);
+    }
+    
+    q = frac_div(n, d, 31);
+    if(neg) return((int32_t)-q);
+    if(q > INT32_MAX) return(INT32_MAX);
+    return(q);
+}
+
+//--------------------------------------------------------------------------------------------------
+int32_t recip_Q15(q15_t x){
+    uint16_t d = (x < 0) ? (uint16_t)-x : (uint16_t)x;
+    uint32_t q;
+    
+    if(d == 0) return(INT32_MAX);
+    
+    // 1.0 in Q15 is 2^15, so 1/x = 2^30/|x|
+    q = frac_div(1, d, 30);
+    return((x < 0) ? -(int32_t)q : (int32_t)q);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint16_t isqrt32(uint32_t x){
+    uint32_t r = 0;
+    uint32_t bit = 1UL << 30;
+    
+    // Find one result bit per iteration, from the top
+    while(bit > x) bit >>= 2;
+    while(bit){
+        if(x >= r + bit){
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        }else{
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    
+    return(r);
+}
+
+//--------------------------------------------------------------------------------------------------
+q15_t sqrt_Q15(q15_t x){
+    uint32_t v;
+    uint16_t r;
+    
+    if(x <= 0) return(0);
+    
+    // sqrt(x/2^15) * 2^15 = sqrt(x * 2^15)
+    v = (uint32_t)x << 15;
+    r = isqrt32(v);
+    
+    // Round up if v is past (r + 0.5)^2 = r^2 + r + 0.25
+    if((v - (uint32_t)r*r) > r) r++;
+    if(r > INT16_MAX) r = INT16_MAX;
+    
+    return(r);
+}
+
+//==================================================================================================
+// Trigonometric Functions
+//==================================================================================================
+
+q15_t sin_Q15(q15_t angle){
+    uint16_t a = angle;
+    uint16_t x = a & 0x3FFF;
+    uint16_t y;
+    
+    // Mirror the 2nd and 4th quadrants onto the 1st
+    if(a & 0x4000) x = 0x4000 - x;
+    
+    y = tbl_interp(Sin_table, x, FIXEDPT_SIN_TABLE_BITS, 14);
+    if(y > INT16_MAX) y = INT16_MAX;
+    
+    // Negative half
+    if(a & 0x8000) return(-(int16_t)y);
+    return(y);
+}
+
+//--------------------------------------------------------------------------------------------------
+q15_t cos_Q15(q15_t angle){
+    return(sin_Q15((uint16_t)angle + 0x4000));
+}
+
+//--------------------------------------------------------------------------------------------------
+q15_t atan2_Q15(q15_t y, q15_t x){
+    int32_t xx = (int32_t)x * 16384;
+    int32_t yy = (int32_t)y * 16384;
+    int32_t tmp;
+    uint32_t z = 0;
+    uint8_t i;
+    
+    if((x == 0) && (y == 0)) return(0);
+    
+    // Rotate left half-plane by pi so that the iterations converge
+    if(xx < 0){
+        xx = -xx;
+        yy = -yy;
+        z = 0x80000000;
+    }
+    
+    // CORDIC vectoring: rotate (x,y) onto the x axis. The gain of ~1.647 can't overflow since
+    // the inputs were only shifted to 2^29
+    for(i=0; i<16; i++){
+        tmp = xx;
+        if(yy > 0){
+            xx += yy >> i;
+            yy -= tmp >> i;
+            z += pgm_read_dword(&Atan_table[i]);
+        }else{
+            xx -= yy >> i;
+            yy += tmp >> i;
+            z -= pgm_read_dword(&Atan_table[i]);
+        }
+    }
+    
+    // Full turn to Q15 half turns, rounded
+    return((int16_t)((z + 0x8000) >> 16));
+}
+
+//==================================================================================================
+// Logarithm and Exponent
+//==================================================================================================
+
+int32_t log2_Q16(uint32_t x){
+    int8_t e = 31;
+    uint32_t m;
+    uint16_t f;
+    
+    if(x == 0) return(INT32_MIN);
+    
+    // Normalize so the MSB is at bit 31
+    while(!(x & 0xFF000000)){
+        x <<= 8;
+        e -= 8;
+    }
+    while(!(x & 0x80000000)){
+        x <<= 1;
+        e--;
+    }
+    
+    // Bits below the MSB are the fraction f of the mantissa (1+f). Round it to Q16
+    m = (x >> 15) + ((x >> 14) & 1);
+    if(m & 0x20000){
+        e++;
+        m = 0;
+    }
+    f = m;
+    
+    // log2(1+f) = f + deviation
+    m = (tbl_interp(Log2_table, f, FIXEDPT_LOG2_TABLE_BITS, 16) + 2) >> 2;
+    return(((int32_t)e << 16) + f + m);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint32_t exp2_Q16(int32_t x){
+    int16_t e = x >> 16;
+    uint16_t f = x;
+    uint32_t m;
+    
+    if(e >= 16) return(UINT32_MAX);
+    if(e < -17) return(0);
+    
+    // 2^f = 1 + f - deviation
+    m = 0x10000UL + f - ((tbl_interp(Exp2_table, f, FIXEDPT_EXP2_TABLE_BITS, 16) + 2) >> 2);
+    
+    if(e >= 0) return(m << e);
+    e = -e;
+    return((m + (1UL << (e-1))) >> e);
+}
+
+//==================================================================================================
+// Block Operations
+//==================================================================================================
+
+void mpy_Q16_block(uint16_t *dst, const uint16_t *src, uint16_t Q16, size_t n){
+    UNROLL4(n, *dst++ = umulhi16(*src++, Q16));
+}
+
+//--------------------------------------------------------------------------------------------------
+void mpys_Q16_block(int16_t *dst, const int16_t *src, uint16_t Q16, size_t n){
+    UNROLL4(n, *dst++ = smulhi16(*src++, Q16));
+}
+
+//--------------------------------------------------------------------------------------------------
+void scale_Q15_block(q15_t *dst, const q15_t *src, q15_t k, size_t n){
+    UNROLL4(n, *dst++ = mul_Q15(*src++, k));
+}
+
+//--------------------------------------------------------------------------------------------------
+void mul_Q15_block(q15_t *dst, const q15_t *a, const q15_t *b, size_t n){
+    UNROLL4(n, *dst++ = mul_Q15(*a++, *b++));
+}
+
+//--------------------------------------------------------------------------------------------------
+void add_Q15_block(q15_t *dst, const q15_t *a, const q15_t *b, size_t n){
+    UNROLL4(n, *dst++ = add_Q15(*a++, *b++));
+}
+
+//--------------------------------------------------------------------------------------------------
+int32_t mac_Q15_block(int32_t acc, const q15_t *a, const q15_t *b, size_t n){
+    UNROLL4(n, acc = mac_Q15(acc, *a++, *b++));
+    return(acc);
+}
@@ -1,6 +1,68 @@
 #ifndef FIXEDPT_H
 #define FIXEDPT_H
 
+/**
+* \file
+* \brief Fixed-point math
+*
+* Unsigned Q0.N scaling (mpy_Q*) and a signed Q7/Q15/Q31 library. Q formats have 1 sign bit and 7,
+* 15 or 31 fractional bits, covering [-1.0, 1.0). Results that don't fit are saturated.
+*
+* On devices with a hardware multiplier, the Q15 multiply kernels use FMUL/MUL inline assembly.
+* The C versions give identical results.
+*
+* | Function          | Result                    | Cycles (AVR asm) |
+* |-------------------|---------------------------|------------------|
+* | mul_Q15()         | Rounded. Error <= 0.5 LSB | 24 + saturation  |
+* | mac_Q15()         | Exact                     | 24               |
+* | mul_Q31()         | Rounded. Error <= 0.5 LSB | C only           |
+* | div_Q15()         | Rounded. Error <= 0.5 LSB | C only           |
+* | div_Q31()         | Rounded. Error <= 0.5 LSB | C only           |
+* | recip_Q15()       | Rounded. Error <= 0.5 LSB | C only           |
+* | sqrt_Q15()        | Rounded. Error <= 0.5 LSB | C only           |
+* | isqrt32()         | Truncated                 | C only           |
+* | sin_Q15()         | See below                 | C only           |
+* | cos_Q15()         | See below                 | C only           |
+* | atan2_Q15()       | Error <= 1 LSB            | C only           |
+* | log2_Q16()        | See below                 | C only           |
+* | exp2_Q16()        | See below                 | C only           |
+* | mpy_Q16_block()   | Same as mpy_Q16()         | 18 per element   |
+* | mpys_Q16_block()  | Same as mpys_Q16()        | 19 per element   |
+* | scale_Q15_block() | Same as mul_Q15()         | 24 per element   |
+* | mul_Q15_block()   | Same as mul_Q15()         | 24 per element   |
+* | mac_Q15_block()   | Same as mac_Q15()         | 24 per element   |
+*
+* Cycle counts are for the assembly sequence, from the instruction timings. Operand loads are not
+* included. The block functions add pointer loads and stores, plus loop overhead that is unrolled
+* 4 times. This has not been measured on hardware.
+*
+* sin, log2 and exp2 interpolate lookup tables in flash. Their size is set in fixedpt_config.h.
+* Maximum error in LSBs for each table size: (exp2 error is relative to the result's mantissa)
+*
+* | Table bits | Flash per table | sin_Q15() | log2_Q16() | exp2_Q16() |
+* |------------|-----------------|-----------|------------|------------|
+* | 4          | 34 bytes        | 40        | 44         | 16         |
+* | 5          | 66 bytes        | 10.5      | 12.2       | 4.5        |
+* | 6          | 130 bytes       | 3.1       | 3.9        | 1.6        |
+* | 7          | 258 bytes       | 1.4       | 1.8        | 0.9        |
+* | 8          | 514 bytes       | 1.0       | 1.4        | 0.8        |
+**/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+//==================================================================================================
+// Types and Constants
+//==================================================================================================
+
+typedef int8_t  q7_t;   ///< Signed Q0.7
+typedef int16_t q15_t;  ///< Signed Q0.15
+typedef int32_t q31_t;  ///< Signed Q0.31
+
 /// Convert a floating point constant to fixed point QN
 #define CONST_QN(x,N)   ((x)*(1ULL<<(N)))
 
@@ -13,8 +75,21 @@
 /// Convert a floating point constant to fixed point Q0.32
 #define CONST_Q32(x)    CONST_QN(x,32)
 
+/// Convert a floating point constant (-1.0 to 1.0) to signed Q0.7. 1.0 is saturated.
+#define CONST_Q7(x)     ((q7_t)(((x) >= 1.0) ? INT8_MAX : CONST_QN(x,7)))
+
+/// Convert a floating point constant (-1.0 to 1.0) to signed Q0.15. 1.0 is saturated.
+#define CONST_Q15(x)    ((q15_t)(((x) >= 1.0) ? INT16_MAX : CONST_QN(x,15)))
+
+/// Convert a floating point constant (-1.0 to 1.0) to signed Q0.31. 1.0 is saturated.
+#define CONST_Q31(x)    ((q31_t)(((x) >= 1.0) ? INT32_MAX : CONST_QN(x,31)))
+
+//==================================================================================================
+// Unsigned Scaling
+//==================================================================================================
+
 /// Scale an unsigned 8-bit value by an unsigned Q0.8
-__inline__ uint8_t mpy_Q8(uint8_t x, uint8_t Q8){
+static __inline__ uint8_t mpy_Q8(uint8_t x, uint8_t Q8){
     uint16_t P;
     P = (uint16_t)x * Q8;
     P >>= 8;
@@ -22,7 +97,7 @@ __inline__ uint8_t mpy_Q8(uint8_t x, uint8_t Q8){
 }
 
 /// Scale an unsigned 16-bit value by an unsigned Q0.16
-__inline__ uint16_t mpy_Q16(uint16_t x, uint16_t Q16){
+static __inline__ uint16_t mpy_Q16(uint16_t x, uint16_t Q16){
     uint32_t P;
     P = (uint32_t)x * Q16;
     P >>= 16;
@@ -30,15 +105,22 @@ __inline__ uint16_t mpy_Q16(uint16_t x, uint16_t Q16){
 }
 
 /// Scale an unsigned 32-bit value by an unsigned Q0.32
-__inline__ uint32_t mpy_Q32(uint32_t x, uint32_t Q32){
-    uint64_t P;
-    P = (uint64_t)x * Q32;
-    P >>= 32;
-    return(P);
+static __inline__ uint32_t mpy_Q32(uint32_t x, uint32_t Q32){
+    uint32_t mid;
+    uint16_t xh = x >> 16;
+    uint16_t xl = x;
+    uint16_t qh = Q32 >> 16;
+    uint16_t ql = Q32;
+    
+    // 16x16 partial products. Avoids 64-bit math, which is slow on AVR.
+    mid = (((uint32_t)xh * ql) & 0xFFFF) + (((uint32_t)xl * qh) & 0xFFFF)
+        + (((uint32_t)xl * ql) >> 16);
+    return((uint32_t)xh * qh + (((uint32_t)xh * ql) >> 16) + (((uint32_t)xl * qh) >> 16)
+           + (mid >> 16));
 }
 
 /// Scale a signed 8-bit value by an unsigned Q0.8
-__inline__ int8_t mpys_Q8(int8_t x, uint8_t Q8){
+static __inline__ int8_t mpys_Q8(int8_t x, uint8_t Q8){
     int16_t P;
     P = (int16_t)x * Q8;
     P >>= 8;
@@ -46,7 +128,7 @@ __inline__ int8_t mpys_Q8(int8_t x, uint8_t Q8){
 }
 
 /// Scale a signed 16-bit value by an unsigned Q0.16
-__inline__ int16_t mpys_Q16(int16_t x, uint16_t Q16){
+static __inline__ int16_t mpys_Q16(int16_t x, uint16_t Q16){
     int32_t P;
     P = (int32_t)x * Q16;
     P >>= 16;
@@ -54,11 +136,293 @@ __inline__ int16_t mpys_Q16(int16_t x, uint16_t Q16){
 }
 
 /// Scale a signed 32-bit value by an unsigned Q0.32
-__inline__ int32_t mpys_Q32(int32_t x, uint32_t Q32){
-    int64_t P;
-    P = (int64_t)x * Q32;
-    P >>= 32;
-    return(P);
+static __inline__ int32_t mpys_Q32(int32_t x, uint32_t Q32){
+    uint32_t mid;
+    int16_t xh = x >> 16;
+    uint16_t xl = x;
+    uint16_t qh = Q32 >> 16;
+    uint16_t ql = Q32;
+    
+    // Same as mpy_Q32(), with the upper half of x signed
+    mid = (((int32_t)xh * ql) & 0xFFFF) + (((uint32_t)xl * qh) & 0xFFFF)
+        + (((uint32_t)xl * ql) >> 16);
+    return((int32_t)xh * qh + (((int32_t)xh * ql) >> 16) + (int32_t)(((uint32_t)xl * qh) >> 16)
+           + (int32_t)(mid >> 16));
+}
+
+//==================================================================================================
+// Saturating Add and Subtract
+//==================================================================================================
+
+/// Clamp a 16-bit value to Q7
+static __inline__ q7_t sat_Q7(int16_t x){
+    if(x > INT8_MAX) return(INT8_MAX);
+    if(x < INT8_MIN) return(INT8_MIN);
+    return(x);
+}
+
+/// Clamp a 32-bit value to Q15
+static __inline__ q15_t sat_Q15(int32_t x){
+    if(x > INT16_MAX) return(INT16_MAX);
+    if(x < INT16_MIN) return(INT16_MIN);
+    return(x);
+}
+
+/// Saturating Q7 add
+static __inline__ q7_t add_Q7(q7_t a, q7_t b){
+    return(sat_Q7((int16_t)a + b));
+}
+
+/// Saturating Q7 subtract
+static __inline__ q7_t sub_Q7(q7_t a, q7_t b){
+    return(sat_Q7((int16_t)a - b));
+}
+
+/// Saturating Q15 add
+static __inline__ q15_t add_Q15(q15_t a, q15_t b){
+    return(sat_Q15((int32_t)a + b));
+}
+
+/// Saturating Q15 subtract
+static __inline__ q15_t sub_Q15(q15_t a, q15_t b){
+    return(sat_Q15((int32_t)a - b));
+}
+
+/// Saturating Q31 add
+static __inline__ q31_t add_Q31(q31_t a, q31_t b){
+    q31_t s = (uint32_t)a + (uint32_t)b;
+    // Overflow if both operands have the same sign, and the result has the other one
+    if(((a ^ s) & (b ^ s)) < 0){
+        s = (a < 0) ? INT32_MIN : INT32_MAX;
+    }
+    return(s);
+}
+
+/// Saturating Q31 subtract
+static __inline__ q31_t sub_Q31(q31_t a, q31_t b){
+    q31_t s = (uint32_t)a - (uint32_t)b;
+    // Overflow if the operands have different signs, and the result doesn't have the sign of a
+    if(((a ^ b) & (a ^ s)) < 0){
+        s = (a < 0) ? INT32_MIN : INT32_MAX;
+    }
+    return(s);
+}
+
+//==================================================================================================
+// Multiply
+//==================================================================================================
+
+/// Q7 multiply, rounded to nearest. -1.0 * -1.0 saturates.
+static __inline__ q7_t mul_Q7(q7_t a, q7_t b){
+    int16_t P = (int16_t)a * b;
+    if(P == 0x4000) return(INT8_MAX);
+    return((P + 0x40) >> 7);
 }
 
+/// Q15 multiply, rounded to nearest. -1.0 * -1.0 saturates.
+static __inline__ q15_t mul_Q15(q15_t a, q15_t b){
+    if((a == INT16_MIN) && (b == INT16_MIN)) return(INT16_MAX);
+    #if defined(__AVR_HAVE_MUL__)
+        q15_t r;
+        uint8_t mid;
+        uint8_t zero;
+        
+        // Fractional 16x16 multiply into a Q31 product. The lowest byte is never needed.
+        __asm__(
+            "clr    %[z]                \n\t"
+            "fmuls  %B[a], %B[b]        \n\t" // ah * bh
+            "movw   %A[r], r0           \n\t"
+            "fmul   %A[a], %A[b]        \n\t" // al * bl
+            "adc    %A[r], %[z]         \n\t"
+            "mov    %[m], r1            \n\t"
+            "fmulsu %B[a], %A[b]        \n\t" // ah * bl
+            "sbc    %B[r], %[z]         \n\t"
+            "add    %[m], r0            \n\t"
+            "adc    %A[r], r1           \n\t"
+            "adc    %B[r], %[z]         \n\t"
+            "fmulsu %B[b], %A[a]        \n\t" // bh * al
+            "sbc    %B[r], %[z]         \n\t"
+            "add    %[m], r0            \n\t"
+            "adc    %A[r], r1           \n\t"
+            "adc    %B[r], %[z]         \n\t"
+            "lsl    %[m]                \n\t" // Round using bit 15 of the product
+            "adc    %A[r], %[z]         \n\t"
+            "adc    %B[r], %[z]         \n\t"
+            "clr    __zero_reg__        \n\t"
+            : [r] "=&r" (r), [m] "=&r" (mid), [z] "=&r" (zero)
+            : [a] "a" (a), [b] "a" (b)
+        );
+        return(r);
+    #else
+        return(((int32_t)a * b + 0x4000) >> 15);
+    #endif
+}
+
+/**
+* \brief Q15 multiply-accumulate
+* \details Adds the exact product of a and b to a Q30 accumulator. Convert the result back to Q15
+*   using Q30_to_Q15(). The accumulator has headroom for sums up to 2.0.
+**/
+static __inline__ int32_t mac_Q15(int32_t acc, q15_t a, q15_t b){
+    #if defined(__AVR_HAVE_MUL__)
+        uint8_t zero;
+        
+        __asm__(
+            "clr    %[z]                \n\t"
+            "muls   %B[a], %B[b]        \n\t" // ah * bh
+            "add    %C[acc], r0         \n\t"
+            "adc    %D[acc], r1         \n\t"
+            "mul    %A[a], %A[b]        \n\t" // al * bl
+            "add    %A[acc], r0         \n\t"
+            "adc    %B[acc], r1         \n\t"
+            "adc    %C[acc], %[z]       \n\t"
+            "adc    %D[acc], %[z]       \n\t"
+            "mulsu  %B[a], %A[b]        \n\t" // ah * bl
+            "sbc    %D[acc], %[z]       \n\t"
+            "add    %B[acc], r0         \n\t"
+            "adc    %C[acc], r1         \n\t"
+            "adc    %D[acc], %[z]       \n\t"
+            "mulsu  %B[b], %A[a]        \n\t" // bh * al
+            "sbc    %D[acc], %[z]       \n\t"
+            "add    %B[acc], r0         \n\t"
+            "adc    %C[acc], r1         \n\t"
+            "adc    %D[acc], %[z]       \n\t"
+            "clr    __zero_reg__        \n\t"
+            : [acc] "+r" (acc), [z] "=&r" (zero)
+            : [a] "a" (a), [b] "a" (b)
+        );
+        return(acc);
+    #else
+        return(acc + (int32_t)a * b);
+    #endif
+}
+
+/// Convert a Q30 accumulator to Q15, rounded to nearest and saturated
+static __inline__ q15_t Q30_to_Q15(int32_t acc){
+    return(sat_Q15((acc >> 15) + ((acc >> 14) & 1)));
+}
+
+/// Q31 multiply, rounded to nearest. -1.0 * -1.0 saturates.
+q31_t mul_Q31(q31_t a, q31_t b);
+
+//==================================================================================================
+// Division and Square Root
+//==================================================================================================
+
+/**
+* \brief Q15 divide, rounded to nearest
+* \details Results outside of [-1.0, 1.0) saturate, including division by 0.
+**/
+q15_t div_Q15(q15_t num, q15_t den);
+
+/**
+* \brief Q31 divide, rounded to nearest
+* \details Results outside of [-1.0, 1.0) saturate, including division by 0.
+**/
+q31_t div_Q31(q31_t num, q31_t den);
+
+/**
+* \brief Reciprocal of a Q15 number
+* \return 1/x in Q16.15, rounded to nearest. Division by 0 saturates.
+**/
+int32_t recip_Q15(q15_t x);
+
+/**
+* \brief Integer square root
+* \return floor(sqrt(x))
+**/
+uint16_t isqrt32(uint32_t x);
+
+/**
+* \brief Q15 square root, rounded to nearest
+* \return sqrt(x). 0 if x is negative.
+**/
+q15_t sqrt_Q15(q15_t x);
+
+//==================================================================================================
+// Trigonometric Functions
+//==================================================================================================
+/* Angles are Q15 half turns: -32768 is -pi and 32767 is just below pi. Adding angles wraps around
+ * the circle correctly.
+ */
+
+/// Convert a floating point angle in radians (-pi to pi) to Q15 half turns
+#define CONST_ANGLE(x)  ((q15_t)CONST_QN((x)/3.14159265358979, 15))
+
+/**
+* \brief Q15 sine
+* \details Linear interpolation in a quarter wave table in flash. See \c FIXEDPT_SIN_TABLE_BITS
+* \param angle Angle in Q15 half turns
+**/
+q15_t sin_Q15(q15_t angle);
+
+/**
+* \brief Q15 cosine
+* \details Same as sin_Q15() with the angle shifted by pi/2
+* \param angle Angle in Q15 half turns
+**/
+q15_t cos_Q15(q15_t angle);
+
+/**
+* \brief Angle of the vector (x, y) using CORDIC
+* \details 16 shift-and-add iterations. No multiplies.
+* \return Angle in Q15 half turns. 0 if both x and y are 0. An angle of pi is returned as -pi.
+**/
+q15_t atan2_Q15(q15_t y, q15_t x);
+
+//==================================================================================================
+// Logarithm and Exponent
+//==================================================================================================
+
+/**
+* \brief Base 2 logarithm
+* \details For a number in QN format, subtract (N << 16) from the result.
+* \param x Unsigned integer
+* \return log2(x) in signed Q15.16. INT32_MIN if x is 0.
+**/
+int32_t log2_Q16(uint32_t x);
+
+/**
+* \brief Base 2 exponent
+* \param x Exponent in signed Q15.16
+* \return 2^x in unsigned Q16.16, rounded. Saturates to UINT32_MAX for x >= 16.0
+**/
+uint32_t exp2_Q16(int32_t x);
+
+//==================================================================================================
+// Block Operations
+//==================================================================================================
+/* These apply the functions above to whole arrays. The loops are unrolled and the multiplies are
+ * inlined, so the call and loop overhead is paid once per block instead of once per element. The
+ * destination may be the same array as a source.
+ */
+
+/// Scale an array of unsigned 16-bit values by an unsigned Q0.16
+void mpy_Q16_block(uint16_t *dst, const uint16_t *src, uint16_t Q16, size_t n);
+
+/// Scale an array of signed 16-bit values by an unsigned Q0.16
+void mpys_Q16_block(int16_t *dst, const int16_t *src, uint16_t Q16, size_t n);
+
+/// Multiply an array of Q15 values by a Q15 constant. Same rounding as mul_Q15()
+void scale_Q15_block(q15_t *dst, const q15_t *src, q15_t k, size_t n);
+
+/// Element-wise Q15 multiply. Same rounding as mul_Q15()
+void mul_Q15_block(q15_t *dst, const q15_t *a, const q15_t *b, size_t n);
+
+/// Element-wise saturating Q15 add
+void add_Q15_block(q15_t *dst, const q15_t *a, const q15_t *b, size_t n);
+
+/**
+* \brief Q15 dot product
+* \details Adds the exact product of each pair of elements to a Q30 accumulator, like mac_Q15().
+*   Convert the result back to Q15 using Q30_to_Q15().
+* \param acc Initial accumulator value. 0 for a plain dot product
+* \return Accumulator
+**/
+int32_t mac_Q15_block(int32_t acc, const q15_t *a, const q15_t *b, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,237 @@
+/**
+* \file
+* \brief C++ fixed-point type over fixedpt.h
+*
+* Fixed<I,F,S> holds a number with I integer bits, F fractional bits and a sign bit if S is true.
+* The total must be 8, 16 or 32 bits. Constants are converted at compile time:
+* \code
+* constexpr Q15 gain(0.75);
+* constexpr Q15 offset(-0.1);
+* constexpr UQ16 scale(0.3);
+* Fixed<16,0,false> counts = Fixed<16,0,false>::from_raw(adc);
+* counts = counts * scale;     // mpy_Q16()
+* Q15 y = gain * x + offset;   // mul_Q15(), add_Q15()
+* \endcode
+*
+* Operators only exist for the combinations that fixedpt.h has a kernel for, so nothing is widened
+* behind the caller's back. Anything else fails to compile:
+* - Signed Q0.7, Q0.15 or Q0.31 times the same format: mul_Q7(), mul_Q15(), mul_Q31()
+* - Any format times an unsigned Q0.N of the same size: mpy_QN() or mpys_QN(). The result has the
+*   format of the left operand.
+* - Add and subtract need the same format. Signed Q0.7, Q0.15 and Q0.31 saturate. Other formats
+*   wrap like the underlying integers.
+*
+* Use fixed_cast() to change formats explicitly.
+*
+* All operations are inline and the object is the raw integer, so the generated code is the same
+* as calling the C functions directly.
+*
+* \note The floating point constructor is meant for constants. Calling it at runtime pulls in
+* floating point math.
+**/
+
+#ifndef FIXEDPT_HPP
+#define FIXEDPT_HPP
+
+#include <stdint.h>
+
+#include "fixedpt.h"
+
+template<uint8_t I, uint8_t F, bool S> class Fixed;
+
+///\cond INTERNAL
+namespace fixedpt_detail {
+
+    /// Raw integer type for a given size and signedness
+    template<uint8_t Bits, bool S> struct storage;
+    template<> struct storage<8, true>      { typedef int8_t type; };
+    template<> struct storage<8, false>     { typedef uint8_t type; };
+    template<> struct storage<16, true>     { typedef int16_t type; };
+    template<> struct storage<16, false>    { typedef uint16_t type; };
+    template<> struct storage<32, true>     { typedef int32_t type; };
+    template<> struct storage<32, false>    { typedef uint32_t type; };
+
+    /// Converts a real number to a raw value, rounded to nearest and saturated
+    template<typename T>
+    constexpr T from_real(double x, double scale, T min, T max){
+        return((x * scale >= (double)max) ? max :
+               (x * scale <= (double)min) ? min :
+               (T)(x * scale + ((x < 0) ? -0.5 : 0.5)));
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // Scaling by an unsigned Q0.N
+    inline uint8_t mpy(uint8_t x, uint8_t q){ return(mpy_Q8(x, q)); }
+    inline int8_t mpy(int8_t x, uint8_t q){ return(mpys_Q8(x, q)); }
+    inline uint16_t mpy(uint16_t x, uint16_t q){ return(mpy_Q16(x, q)); }
+    inline int16_t mpy(int16_t x, uint16_t q){ return(mpys_Q16(x, q)); }
+    inline uint32_t mpy(uint32_t x, uint32_t q){ return(mpy_Q32(x, q)); }
+    inline int32_t mpy(int32_t x, uint32_t q){ return(mpys_Q32(x, q)); }
+
+    //----------------------------------------------------------------------------------------------
+    /// Add and subtract. Wraps unless specialized below
+    template<class T> struct addsub {
+        static typename T::raw_t add(typename T::raw_t a, typename T::raw_t b){ return(a + b); }
+        static typename T::raw_t sub(typename T::raw_t a, typename T::raw_t b){ return(a - b); }
+    };
+    template<> struct addsub<Fixed<0,7,true> > {
+        static q7_t add(q7_t a, q7_t b){ return(add_Q7(a, b)); }
+        static q7_t sub(q7_t a, q7_t b){ return(sub_Q7(a, b)); }
+    };
+    template<> struct addsub<Fixed<0,15,true> > {
+        static q15_t add(q15_t a, q15_t b){ return(add_Q15(a, b)); }
+        static q15_t sub(q15_t a, q15_t b){ return(sub_Q15(a, b)); }
+    };
+    template<> struct addsub<Fixed<0,31,true> > {
+        static q31_t add(q31_t a, q31_t b){ return(add_Q31(a, b)); }
+        static q31_t sub(q31_t a, q31_t b){ return(sub_Q31(a, b)); }
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// True if B is an unsigned Q0.N of the same size as A
+    template<class A, class B> struct is_scale {
+        static const bool value = !B::is_signed && (B::int_bits == 0) && (B::bits == A::bits);
+    };
+
+    /// Multiply dispatch. The primary template is an unsupported combination
+    template<class A, class B, bool Scale = is_scale<A,B>::value> struct mul {
+        static_assert(sizeof(A) == 0, "Fixed: no multiply kernel for these formats. The right "
+                      "operand must be the same signed Q0.7/Q0.15/Q0.31 as the left one, or an "
+                      "unsigned Q0.N of the same size");
+    };
+    template<class A, class B> struct mul<A, B, true> {
+        static typename A::raw_t op(typename A::raw_t a, typename B::raw_t b){ return(mpy(a, b)); }
+    };
+    template<> struct mul<Fixed<0,7,true>, Fixed<0,7,true>, false> {
+        static q7_t op(q7_t a, q7_t b){ return(mul_Q7(a, b)); }
+    };
+    template<> struct mul<Fixed<0,15,true>, Fixed<0,15,true>, false> {
+        static q15_t op(q15_t a, q15_t b){ return(mul_Q15(a, b)); }
+    };
+    template<> struct mul<Fixed<0,31,true>, Fixed<0,31,true>, false> {
+        static q31_t op(q31_t a, q31_t b){ return(mul_Q31(a, b)); }
+    };
+}
+///\endcond
+
+//==================================================================================================
+// Fixed-Point Type
+//==================================================================================================
+
+/**
+ * \brief Fixed-point number
+ * \tparam I Number of integer bits
+ * \tparam F Number of fractional bits
+ * \tparam S true if there is a sign bit
+ **/
+template<uint8_t I, uint8_t F, bool S = true>
+class Fixed {
+public:
+    static const uint8_t int_bits = I;
+    static const uint8_t frac_bits = F;
+    static const bool is_signed = S;
+    static const uint8_t bits = I + F + (S ? 1 : 0);
+
+    static_assert((bits == 8) || (bits == 16) || (bits == 32),
+                  "Fixed: integer, fractional and sign bits must add up to 8, 16 or 32");
+
+    typedef typename fixedpt_detail::storage<bits, S>::type raw_t;
+
+    /// Zero
+    constexpr Fixed() : v(0) {}
+
+    /// Convert a real number, rounded to nearest. Values out of range saturate.
+    explicit constexpr Fixed(double x)
+        : v(fixedpt_detail::from_real<raw_t>(x, (double)(1ULL << F), min_raw(), max_raw())) {}
+
+    /// Construct from a raw integer
+    static constexpr Fixed from_raw(raw_t r){ return(Fixed(r, 0)); }
+
+    /// Get the raw integer
+    constexpr raw_t raw() const { return(v); }
+
+    /// Convert to floating point. Pulls in floating point math if used at runtime
+    constexpr double to_double() const { return(v / (double)(1ULL << F)); }
+
+    //----------------------------------------------------------------------------------------------
+    /// Saturating for signed Q0.7, Q0.15 and Q0.31
+    Fixed operator+(Fixed b) const { return(from_raw(fixedpt_detail::addsub<Fixed>::add(v, b.v))); }
+    Fixed operator-(Fixed b) const { return(from_raw(fixedpt_detail::addsub<Fixed>::sub(v, b.v))); }
+    Fixed &operator+=(Fixed b){ return(*this = *this + b); }
+    Fixed &operator-=(Fixed b){ return(*this = *this - b); }
+
+    /// Negate. Wraps for the most negative value
+    constexpr Fixed operator-() const { return(from_raw(-v)); }
+
+    template<uint8_t I2, uint8_t F2, bool S2>
+    Fixed operator+(Fixed<I2,F2,S2>) const {
+        static_assert(I2 != I2, "Fixed: operands of + have different formats. Use fixed_cast()");
+        return(*this);
+    }
+
+    template<uint8_t I2, uint8_t F2, bool S2>
+    Fixed operator-(Fixed<I2,F2,S2>) const {
+        static_assert(I2 != I2, "Fixed: operands of - have different formats. Use fixed_cast()");
+        return(*this);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// See the file description for the supported formats
+    template<uint8_t I2, uint8_t F2, bool S2>
+    Fixed operator*(Fixed<I2,F2,S2> b) const {
+        return(from_raw(fixedpt_detail::mul<Fixed, Fixed<I2,F2,S2> >::op(v, b.raw())));
+    }
+
+    template<uint8_t I2, uint8_t F2, bool S2>
+    Fixed &operator*=(Fixed<I2,F2,S2> b){ return(*this = *this * b); }
+
+    //----------------------------------------------------------------------------------------------
+    constexpr bool operator==(Fixed b) const { return(v == b.v); }
+    constexpr bool operator!=(Fixed b) const { return(v != b.v); }
+    constexpr bool operator<(Fixed b) const { return(v < b.v); }
+    constexpr bool operator>(Fixed b) const { return(v > b.v); }
+    constexpr bool operator<=(Fixed b) const { return(v <= b.v); }
+    constexpr bool operator>=(Fixed b) const { return(v >= b.v); }
+
+private:
+    raw_t v;
+
+    constexpr Fixed(raw_t r, int) : v(r) {}
+
+    static constexpr raw_t max_raw(){
+        return((raw_t)(S ? ((1ULL << (bits - 1)) - 1) : ((1ULL << (bits - 1)) * 2 - 1)));
+    }
+    static constexpr raw_t min_raw(){
+        return((raw_t)(S ? -(int64_t)(1ULL << (bits - 1)) : 0));
+    }
+};
+
+//==================================================================================================
+// Conversion
+//==================================================================================================
+
+/**
+* \brief Change the format of a fixed-point number
+* \details Fractional bits are truncated or zero-extended. Integer bits that don't fit are lost.
+**/
+template<class To, uint8_t I, uint8_t F, bool S>
+constexpr To fixed_cast(Fixed<I,F,S> x){
+    // Shift left as unsigned, since shifting negative values left is undefined
+    return(To::from_raw((To::frac_bits >= F)
+        ? (typename To::raw_t)((typename fixedpt_detail::storage<To::bits, false>::type)x.raw()
+                               << ((To::frac_bits - F) & 31))
+        : (typename To::raw_t)(x.raw() >> ((F - To::frac_bits) & 31))));
+}
+
+//==================================================================================================
+// Common Formats
+//==================================================================================================
+
+typedef Fixed<0,7,true>     Q7;     ///< Signed Q0.7. Same as q7_t
+typedef Fixed<0,15,true>    Q15;    ///< Signed Q0.15. Same as q15_t
+typedef Fixed<0,31,true>    Q31;    ///< Signed Q0.31. Same as q31_t
+typedef Fixed<0,8,false>    UQ8;    ///< Unsigned Q0.8 scale factor for mpy_Q8()
+typedef Fixed<0,16,false>   UQ16;   ///< Unsigned Q0.16 scale factor for mpy_Q16()
+typedef Fixed<0,32,false>   UQ32;   ///< Unsigned Q0.32 scale factor for mpy_Q32()
+
+#endif
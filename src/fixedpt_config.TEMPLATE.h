@@ -0,0 +1,19 @@
+#ifndef FIXEDPT_CONFIG_H
+#define FIXEDPT_CONFIG_H
+
+//==================================================================================================
+// Lookup Tables
+//==================================================================================================
+// The tables are computed by the compiler. Each one has 2^N + 1 entries of 2 bytes, where N is
+// between 4 and 8. See fixedpt.h for the resulting accuracy.
+
+// sin_Q15() and cos_Q15(). Entries cover a quarter wave.
+#define FIXEDPT_SIN_TABLE_BITS  7
+
+// log2_Q16()
+#define FIXEDPT_LOG2_TABLE_BITS 6
+
+// exp2_Q16()
+#define FIXEDPT_EXP2_TABLE_BITS 6
+
+#endif
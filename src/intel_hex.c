@@ -1,42 +1,25 @@
 
 
 #include <stdint.h>
+#include <stdbool.h>
 
+#include "string_ext.h"
 #include "intel_hex.h"
 
 static uint8_t checksum = 0;
 
 //--------------------------------------------------------------------------------------------------
-static int8_t hex2nibble(char c){
-    if((c >= '0') && (c <= '9')){
-        return(c-'0');
-    }else if((c >= 'A') && (c <= 'F')){
-        return(c-'A'+10);
-    }else if((c >= 'a') && (c <= 'f')){
-        return(c-'a'+10);
-    }else{
-        return(-1);
-    }
-}
-
-//--------------------------------------------------------------------------------------------------
-static uint8_t hex2byte(char *str){
-    uint8_t b;
-    int8_t nib;
+/**
+* \brief Parse exactly 2 hex digits and add them to the checksum
+* \return false if str does not start with 2 hex digits
+**/
+static bool hex2byte(const char *str, uint8_t *b){
+    uint32_t n;
     
-    nib = hex2nibble(*str++);
-    if(nib < 0){
-        return(0);
-    }
-    b = nib;
-    b <<= 4;
-    nib = hex2nibble(*str);
-    if(nib < 0){
-        return(0);
-    }
-    b += nib;
-    checksum += b;
-    return(b);
+    if(scan_hex_n(str, 2, &n) != 2) return(false);
+    *b = n;
+    checksum += n;
+    return(true);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -45,35 +28,38 @@ uint8_t parse_intel_hex(char *str, struct ihex_packet *dst){
     
     uint16_t addr;
     uint8_t rectype;
+    uint8_t b;
     
     // Start Code
     if(*str++ != ':') return(IHEX_ERROR);
     checksum = 0;
     
     // Len
-    dst->len = hex2byte(str);
+    if(!hex2byte(str, &dst->len)) return(IHEX_ERROR);
     str += 2;
     
     // addr
-    addr = hex2byte(str);
+    if(!hex2byte(str, &b)) return(IHEX_ERROR);
     str += 2;
+    addr = b;
     addr <<= 8;
-    addr += hex2byte(str);
+    if(!hex2byte(str, &b)) return(IHEX_ERROR);
     str += 2;
+    addr += b;
     
     // Record type
-    rectype = hex2byte(str);
+    if(!hex2byte(str, &rectype)) return(IHEX_ERROR);
     str += 2;
     
     // Data
     if(dst->len > sizeof(dst->data)) return(IHEX_ERROR);
     for(uint8_t i=0; i<dst->len; i++){
-        dst->data[i] = hex2byte(str);
+        if(!hex2byte(str, &dst->data[i])) return(IHEX_ERROR);
         str += 2;
     }
     
     // Checksum
-    hex2byte(str);
+    if(!hex2byte(str, &b)) return(IHEX_ERROR);
     if(checksum != 0) return(IHEX_ERROR);
     
     switch(rectype){
@@ -0,0 +1,225 @@
+/**
+* \file
+* \brief USART in SPI master mode (MSPI) driver
+* \details Each transfer is moved by a pair of EDMA channels: one loads DATA from the TX data and
+*   one stores DATA into the RX buffer. Queued transfers are started from the RX DMA interrupt.
+**/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "fifo.h"
+#include "mspi.h"
+
+#include <mspi_config.h>
+
+//==================================================================================================
+// Preprocessor computations
+//==================================================================================================
+
+// CTRLC bits in MSPI mode
+#define MSPI_UDORD_bm   0x04
+#define MSPI_UCPHA_bm   0x02
+
+#if(MSPI_LSB_FIRST == 1)
+    #define MSPI_CTRLC_ORDER    MSPI_UDORD_bm
+#else
+    #define MSPI_CTRLC_ORDER    0
+#endif
+
+#if((MSPI_MODE == 1) || (MSPI_MODE == 3))
+    #define MSPI_CTRLC_PHASE    MSPI_UCPHA_bm
+#else
+    #define MSPI_CTRLC_PHASE    0
+#endif
+
+//==================================================================================================
+// Variable Declarations
+//==================================================================================================
+
+static mspi_transfer_t *Current; // Transfer in progress. NULL if idle
+
+static mspi_transfer_t *QueueBuf[MSPI_QUEUE_SIZE + 1];
+static FIFO_t Queue;
+
+// DMA source and destination for transfers without TX or RX data
+static uint8_t Dummy_tx;
+static uint8_t Dummy_rx;
+
+//==================================================================================================
+// Functions
+//==================================================================================================
+
+void mspi_init(void){
+    uint8_t dummy;
+    
+    MSPI_DEV.CTRLA = 0;
+    MSPI_DEV.CTRLB = 0;
+    
+    // Enable the EDMA controller without disturbing channels used by other modules. The
+    // channels must be separate peripheral channels without double buffering.
+    EDMA.CTRL = (EDMA.CTRL & ~(EDMA_CHMODE_gm | EDMA_DBUFMODE_gm))
+                | EDMA_CHMODE_PER0123_gc | EDMA_DBUFMODE_DISABLE_gc | EDMA_ENABLE_bm;
+    
+    fifo_init(&Queue, QueueBuf, sizeof(QueueBuf));
+    Current = NULL;
+    Dummy_tx = MSPI_DUMMY_BYTE;
+    
+    /* Init DMA Channels
+     *
+     * TX DMA loads DATA from the transfer's tx data each time DATA is empty.
+     * RX DMA stores each received byte into the transfer's rx buffer. Since every byte sent is also
+     * received, the RX DMA interrupt marks the end of a transfer.
+     */
+    EDMA.MSPI_RX_DMA_CH.CTRLA = EDMA_CH_RESET_bm;
+    EDMA.MSPI_RX_DMA_CH.CTRLA = EDMA_CH_SINGLE_bm;
+    EDMA.MSPI_RX_DMA_CH.CTRLB = MSPI_DMA_INTLVL;
+    EDMA.MSPI_RX_DMA_CH.TRIGSRC = MSPI_RX_DMA_TRIGSRC;
+    
+    EDMA.MSPI_TX_DMA_CH.CTRLA = EDMA_CH_RESET_bm;
+    EDMA.MSPI_TX_DMA_CH.CTRLA = EDMA_CH_SINGLE_bm;
+    EDMA.MSPI_TX_DMA_CH.CTRLB = 0;
+    EDMA.MSPI_TX_DMA_CH.TRIGSRC = MSPI_TX_DMA_TRIGSRC;
+    
+    // Set up pins. SPI modes 2 and 3 idle with SCK high.
+    #if(MSPI_MODE >= 2)
+        (&(MSPI_DEV_PORT.PIN0CTRL))[MSPI_XCK_PIN] |= PORT_INVEN_bm;
+    #else
+        (&(MSPI_DEV_PORT.PIN0CTRL))[MSPI_XCK_PIN] &= ~PORT_INVEN_bm;
+    #endif
+    MSPI_DEV_PORT.OUTCLR = (1 << MSPI_XCK_PIN);
+    MSPI_DEV_PORT.DIRSET = (1 << MSPI_XCK_PIN) | (1 << MSPI_TX_PIN);
+    
+    // Baud rate. BAUDCTRLB must be written first.
+    MSPI_DEV.BAUDCTRLB = (MSPI_BSEL >> 8);
+    MSPI_DEV.BAUDCTRLA = (MSPI_BSEL & 0xFF);
+    
+    MSPI_DEV.CTRLC = USART_CMODE_MSPI_gc | MSPI_CTRLC_ORDER | MSPI_CTRLC_PHASE;
+    MSPI_DEV.CTRLB = USART_RXEN_bm | USART_TXEN_bm;
+    
+    // Discard anything left in the receive buffer
+    while(MSPI_DEV.STATUS & USART_RXCIF_bm){
+        dummy = MSPI_DEV.DATA;
+    }
+    (void)dummy;
+}
+
+//--------------------------------------------------------------------------------------------------
+void mspi_uninit(void){
+    mspi_transfer_t *xfer;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        EDMA.MSPI_RX_DMA_CH.CTRLA = EDMA_CH_RESET_bm;
+        EDMA.MSPI_TX_DMA_CH.CTRLA = EDMA_CH_RESET_bm;
+        MSPI_DEV.CTRLB = 0;
+        
+        if(Current){
+            if(Current->cs_port){
+                Current->cs_port->OUTSET = Current->cs_pin_bm;
+            }
+            Current->busy = false;
+            Current = NULL;
+        }
+        
+        while(fifo_read(&Queue, &xfer, sizeof(xfer)) == 0){
+            xfer->busy = false;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Assert CS and start the DMA channels for a transfer
+* \details Must be called with interrupts disabled, or from the DMA interrupt
+**/
+static void mspi_start(mspi_transfer_t *xfer){
+    if(xfer->cs_port){
+        xfer->cs_port->OUTCLR = xfer->cs_pin_bm;
+    }
+    
+    // RX first so that no received byte is missed
+    if(xfer->rx){
+        EDMA.MSPI_RX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_NONE_gc | EDMA_CH_DIR_INC_gc;
+        EDMA.MSPI_RX_DMA_CH.ADDR = (uintptr_t)xfer->rx;
+    }else{
+        EDMA.MSPI_RX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_NONE_gc | EDMA_CH_DIR_FIXED_gc;
+        EDMA.MSPI_RX_DMA_CH.ADDR = (uintptr_t)&Dummy_rx;
+    }
+    EDMA.MSPI_RX_DMA_CH.TRFCNTL = (xfer->len & 0xFF);
+    EDMA.MSPI_RX_DMA_CH.TRFCNTH = (xfer->len >> 8);
+    EDMA.MSPI_RX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
+    
+    // DATA is empty, so enabling the TX channel starts the transfer
+    if(xfer->tx){
+        EDMA.MSPI_TX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_NONE_gc | EDMA_CH_DIR_INC_gc;
+        EDMA.MSPI_TX_DMA_CH.ADDR = (uintptr_t)xfer->tx;
+    }else{
+        EDMA.MSPI_TX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_NONE_gc | EDMA_CH_DIR_FIXED_gc;
+        EDMA.MSPI_TX_DMA_CH.ADDR = (uintptr_t)&Dummy_tx;
+    }
+    EDMA.MSPI_TX_DMA_CH.TRFCNTL = (xfer->len & 0xFF);
+    EDMA.MSPI_TX_DMA_CH.TRFCNTH = (xfer->len >> 8);
+    EDMA.MSPI_TX_DMA_CH.CTRLB = EDMA_CH_TRNIF_bm | EDMA_CH_ERRIF_bm; // Clear flags
+    EDMA.MSPI_TX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
+}
+
+//--------------------------------------------------------------------------------------------------
+ISR(MSPI_RX_DMA_VECTOR){
+    mspi_transfer_t *xfer = Current;
+    
+    // Clear flags
+    EDMA.MSPI_RX_DMA_CH.CTRLB |= EDMA_CH_TRNIF_bm | EDMA_CH_ERRIF_bm;
+    
+    if(xfer == NULL) return;
+    
+    // Last byte was received, so it has also been shifted out completely.
+    if(!xfer->cs_hold && xfer->cs_port){
+        xfer->cs_port->OUTSET = xfer->cs_pin_bm;
+    }
+    
+    // Start the next transfer before running the callback to keep the gap short
+    if(fifo_read(&Queue, &Current, sizeof(Current)) == 0){
+        mspi_start(Current);
+    }else{
+        Current = NULL;
+    }
+    
+    xfer->busy = false;
+    if(xfer->callback){
+        xfer->callback(xfer);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+int mspi_transfer_start(mspi_transfer_t *xfer){
+    int rc = 0;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        xfer->busy = true;
+        if(Current == NULL){
+            Current = xfer;
+            mspi_start(xfer);
+        }else if(fifo_write(&Queue, &xfer, sizeof(xfer)) != 0){
+            xfer->busy = false;
+            rc = -1;
+        }
+    }
+    
+    return(rc);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool mspi_busy(void){
+    bool busy;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        busy = (Current != NULL);
+    }
+    
+    return(busy);
+}
@@ -0,0 +1,73 @@
+/**
+* \file
+* \brief Include file for the USART in SPI master mode (MSPI) driver
+**/
+
+#ifndef MSPI_H
+#define MSPI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <avr/io.h>
+
+/**
+ * \brief Describes a single chip-select framed transfer
+ **/
+typedef struct mspi_transfer{
+    const void *tx;         ///< Data to send. If NULL, MSPI_DUMMY_BYTE is sent instead
+    void *rx;               ///< Destination of the received data. If NULL, it is discarded
+    uint16_t len;           ///< Number of bytes to transfer. Must not be 0
+    PORT_t *cs_port;        ///< Port of the chip select pin. NULL if not used
+    uint8_t cs_pin_bm;      ///< Chip select pin bitmask. CS is active low
+    bool cs_hold;           ///< Keep CS asserted after this transfer so the next one continues it
+    void (*callback)(struct mspi_transfer *xfer); ///< Called from the DMA interrupt once the
+                                                  ///  transfer completes. NULL disables
+    volatile bool busy;     ///< Set while the transfer is queued or in progress
+} mspi_transfer_t;
+
+/**
+* \brief Initializes the MSPI controller
+* \details Sets up the XCK and TX pins as outputs. Chip select pins must be set up by the user as
+*   outputs that are driven high.
+**/
+void mspi_init(void);
+
+/**
+* \brief Uninitializes the MSPI controller
+* \details Any transfers in progress are aborted.
+**/
+void mspi_uninit(void);
+
+/**
+* \brief Queue a transfer
+*
+* The transfer starts immediately if the bus is idle. Otherwise it starts from the DMA interrupt
+* as soon as the previous one completes. Bytes within a transfer are moved by DMA without any CPU
+* involvement.
+*
+* \note The \ref mspi_transfer_t struct \c xfer, as well as any referenced data \e must remain
+* allocated until \c xfer->busy is cleared.
+*
+* \param xfer Pointer to the transfer description
+* \retval 0 OK
+* \retval -1 Queue is full. Transfer was not queued.
+**/
+int mspi_transfer_start(mspi_transfer_t *xfer);
+
+/**
+* \brief Check if any transfers are queued or in progress
+* \return true if busy
+**/
+bool mspi_busy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
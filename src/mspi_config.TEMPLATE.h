@@ -0,0 +1,48 @@
+#ifndef MSPI_CONFIG_H
+#define MSPI_CONFIG_H
+
+//==================================================================================================
+// MSPI Configuration
+//==================================================================================================
+
+// Select a USART Device
+#define MSPI_DEV            USARTC0
+#define MSPI_DEV_PORT       PORTC
+#define MSPI_XCK_PIN        1
+#define MSPI_TX_PIN         3
+
+// SPI Mode (0-3)
+#define MSPI_MODE           0
+
+// Bit order
+#define MSPI_LSB_FIRST      0
+
+// Value of baud rate register. F_SCK = F_CPU / (2 * (MSPI_BSEL + 1))
+#define MSPI_BSEL           15 // For F_CPU = 32 MHz --> F_SCK = 1 MHz
+
+// Byte sent in transfers that only receive
+#define MSPI_DUMMY_BYTE     0xFF
+
+// Number of transfers that can be queued behind the one in progress
+#define MSPI_QUEUE_SIZE     4
+
+//==================================================================================================
+// DMA Configuration
+//==================================================================================================
+// Transfers longer than 256 bytes require EDMA channels with 16-bit transfer counts.
+
+// DMA Trigger sources
+#define MSPI_RX_DMA_TRIGSRC EDMA_CH_TRIGSRC_USARTC0_RXC_gc
+#define MSPI_TX_DMA_TRIGSRC EDMA_CH_TRIGSRC_USARTC0_DRE_gc
+
+// Select a DMA Channel
+#define MSPI_RX_DMA_CH      CH2
+#define MSPI_RX_DMA_VECTOR  EDMA_CH2_vect
+
+// Select a DMA Channel
+#define MSPI_TX_DMA_CH      CH3
+
+// Select an interrupt priority level
+#define MSPI_DMA_INTLVL     (EDMA_CH_TRNINTLVL1_bm) // Medium priority
+
+#endif
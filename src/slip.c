@@ -0,0 +1,195 @@
+/**
+* \file
+* \brief SLIP packet framing layer
+**/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <util/crc16.h>
+
+#include "uart_io.h"
+#include "slip.h"
+
+//==================================================================================================
+// Variable Declarations
+//==================================================================================================
+
+static struct{
+    uint8_t *buf;
+    size_t size;
+    size_t len;         // Number of bytes in buf of the current frame
+    uint16_t crc;       // Running CRC of the current frame
+    bool esc;           // Previous byte was SLIP_ESC
+    bool discard;       // Current frame is bad. Discard it once its END is received
+    uint16_t errors;
+    void (*handler)(uint8_t *frame, size_t len);
+} RX;
+
+static uint16_t TX_crc;
+
+//==================================================================================================
+//                                          RX Functions
+//==================================================================================================
+
+void slip_init(uint8_t *rxbuf, size_t rxbuf_size, void (*handler)(uint8_t *frame, size_t len)){
+    RX.buf = rxbuf;
+    RX.size = rxbuf_size;
+    RX.len = 0;
+    RX.crc = 0xFFFF;
+    RX.esc = false;
+    RX.discard = false;
+    RX.errors = 0;
+    RX.handler = handler;
+}
+
+//--------------------------------------------------------------------------------------------------
+static void rx_frame_end(void){
+    if(RX.discard){
+        RX.errors++;
+    }else if(RX.len == 0){
+        // Empty frame. Ignore. (Senders may start every frame with an END)
+    }else if((RX.len < 2) || (RX.crc != 0)){
+        // CRC residue is 0 if the frame is intact
+        RX.errors++;
+    }else{
+        if(RX.handler){
+            RX.handler(RX.buf, RX.len - 2);
+        }
+    }
+    
+    RX.len = 0;
+    RX.crc = 0xFFFF;
+    RX.esc = false;
+    RX.discard = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+void slip_process(void){
+    uint8_t chunk[16];
+    size_t count;
+    size_t i;
+    uint8_t c;
+    
+    while((count = uart_rdcount()) != 0){
+        if(count > sizeof(chunk)){
+            count = sizeof(chunk);
+        }
+        uart_read(chunk, count);
+        
+        for(i=0; i<count; i++){
+            c = chunk[i];
+            
+            if(c == SLIP_END){
+                rx_frame_end();
+                continue;
+            }
+            
+            if(RX.esc){
+                RX.esc = false;
+                if(c == SLIP_ESC_END){
+                    c = SLIP_END;
+                }else if(c == SLIP_ESC_ESC){
+                    c = SLIP_ESC;
+                }else{
+                    // Protocol violation
+                    RX.discard = true;
+                }
+            }else if(c == SLIP_ESC){
+                RX.esc = true;
+                continue;
+            }
+            
+            if(RX.discard) continue;
+            
+            if(RX.len < RX.size){
+                RX.buf[RX.len++] = c;
+                RX.crc = _crc_ccitt_update(RX.crc, c);
+            }else{
+                RX.discard = true;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+uint16_t slip_rx_errors(void){
+    return(RX.errors);
+}
+
+//==================================================================================================
+//                                          TX Functions
+//==================================================================================================
+
+/**
+* \brief Escape and send data without updating the CRC
+**/
+static void tx_escaped(const uint8_t *data, size_t len){
+    const uint8_t *run;
+    uint8_t esc[2];
+    
+    esc[0] = SLIP_ESC;
+    
+    // Pass runs of ordinary bytes to the UART in one call
+    run = data;
+    while(len){
+        if(*data == SLIP_END){
+            esc[1] = SLIP_ESC_END;
+        }else if(*data == SLIP_ESC){
+            esc[1] = SLIP_ESC_ESC;
+        }else{
+            data++;
+            len--;
+            continue;
+        }
+        
+        if(data != run){
+            uart_write((void*)run, data - run);
+        }
+        uart_write(esc, 2);
+        data++;
+        len--;
+        run = data;
+    }
+    
+    if(data != run){
+        uart_write((void*)run, data - run);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void slip_send_begin(void){
+    // Leading END flushes out any line noise the receiver may have collected
+    uart_putc(SLIP_END);
+    TX_crc = 0xFFFF;
+}
+
+//--------------------------------------------------------------------------------------------------
+void slip_send_data(const void *data, size_t len){
+    const uint8_t *u8data = data;
+    size_t i;
+    
+    for(i=0; i<len; i++){
+        TX_crc = _crc_ccitt_update(TX_crc, u8data[i]);
+    }
+    
+    tx_escaped(u8data, len);
+}
+
+//--------------------------------------------------------------------------------------------------
+void slip_send_end(void){
+    uint8_t crc[2];
+    
+    crc[0] = TX_crc & 0xFF;
+    crc[1] = TX_crc >> 8;
+    tx_escaped(crc, 2);
+    uart_putc(SLIP_END);
+}
+
+//--------------------------------------------------------------------------------------------------
+void slip_send(const void *data, size_t len){
+    slip_send_begin();
+    slip_send_data(data, len);
+    slip_send_end();
+}
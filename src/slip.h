@@ -0,0 +1,90 @@
+/**
+* \file
+* \brief Include file for the SLIP packet framing layer
+*
+* Binary packets are framed over uart_io using SLIP (RFC 1055) byte stuffing. Each frame carries a
+* trailing CRC-16/CCITT (avr-libc _crc_ccitt_update(), initial value 0xFFFF) sent LSB first.
+*
+* Frames are sent as: END, escaped payload, escaped CRC, END
+*
+* Received frames are decoded incrementally by slip_process(). It can be called from onIdle(), or
+* used as the handler of an RX event:
+*
+* \code
+*     struct uart_rx_eventctl ctl;
+*     ctl.threshold = 0;
+*     ctl.delimiter = SLIP_END;
+*     ctl.idle_ticks = 0;
+*     ctl.handler = slip_process;
+*     uart_rx_event_start(&ctl);
+* \endcode
+**/
+
+#ifndef SLIP_H
+#define SLIP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SLIP_END        0xC0
+#define SLIP_ESC        0xDB
+#define SLIP_ESC_END    0xDC
+#define SLIP_ESC_ESC    0xDD
+
+/**
+* \brief Initialize the SLIP framing layer
+* \param rxbuf Buffer to assemble received frames in. Must remain allocated.
+* \param rxbuf_size Size of \c rxbuf. Must fit the largest payload plus the 2-byte CRC.
+* \param handler Function to call with each received frame that passes its CRC check. \c frame
+*   points into \c rxbuf and is only valid until the handler returns.
+**/
+void slip_init(uint8_t *rxbuf, size_t rxbuf_size, void (*handler)(uint8_t *frame, size_t len));
+
+/**
+* \brief Process any data received from the UART
+* \details Decodes all bytes that are currently available without blocking. The frame handler is
+*   called from within this function.
+**/
+void slip_process(void);
+
+/**
+* \brief Get the number of received frames that were discarded
+* \details Frames are discarded if the CRC does not match, a bad escape sequence is received, or
+*   the frame does not fit in the receive buffer.
+**/
+uint16_t slip_rx_errors(void);
+
+/**
+* \brief Send a complete frame
+* \param data Pointer to the payload
+* \param len Number of payload bytes
+**/
+void slip_send(const void *data, size_t len);
+
+/**
+* \brief Start sending a frame in pieces
+* \details Use slip_send_data() to send the payload and slip_send_end() to finish the frame.
+**/
+void slip_send_begin(void);
+
+/**
+* \brief Send part of a frame's payload
+* \param data Pointer to the data
+* \param len Number of bytes
+**/
+void slip_send_data(const void *data, size_t len);
+
+/**
+* \brief Finish sending a frame
+**/
+void slip_send_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
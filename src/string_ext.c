@@ -44,180 +44,392 @@
 
 #include <stdint.h>
 #include <stddef.h>
-#include <stdlib.h>
+#include <stdbool.h>
+
+#include <avr/pgmspace.h>
+
 #include "string_ext.h"
 
 //--------------------------------------------------------------------------------------------------
 ///\cond INTERNAL
 
-#if defined(__TI_COMPILER_VERSION__)
-    #define USE_DADD_ENHANCEMENT    1
-#elif defined(__GNUC__) && defined(__MSP430__)
-    #define USE_DADD_ENHANCEMENT    1
-#else
-    #define USE_DADD_ENHANCEMENT    0
-#endif
+/* Decimal conversion
+ * Numbers are split into groups of up to 4 digits by subtracting shifted powers of ten. Each group
+ * is split into 2-digit pairs using a reciprocal multiply, and each pair is looked up in a table.
+ */
+
+// "00", "01", ... "99"
+static const char Digit_pairs[200] PROGMEM =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+* \brief Write 2 digits of n (0-99)
+**/
+static void put_2digits(char *str, uint8_t n){
+    const char *pair = &Digit_pairs[n*2];
+    str[0] = pgm_read_byte(pair);
+    str[1] = pgm_read_byte(pair+1);
+}
+
+/**
+* \brief Write 4 digits of n (0-9999), including leading zeros
+**/
+static void put_4digits(char *str, uint16_t n){
+    uint8_t hi;
+    
+    // n/100. Exact for n < 43699
+    hi = ((uint32_t)n * 0x147B) >> 19;
+    put_2digits(str, hi);
+    put_2digits(str+2, n - hi*100);
+}
+
+/**
+* \brief Output the significant digits of a number that was converted with leading zeros
+* \param buffer Same as the snprint_d* functions
+* \param buf_size Same as the snprint_d* functions
+* \param str Digits with leading zeros
+* \param len Number of digits in str
+* \param neg Prefix the number with a '-'
+* \param keep Number of characters at the end of str that are never skipped as leading zeros
+* \return Number of characters in the complete string
+**/
+static uint8_t put_digits(char *buffer, size_t buf_size, const char *str, uint8_t len, bool neg,
+                          uint8_t keep){
+    uint8_t nchars;
+    uint8_t i;
+    
+    // Skip leading zeros
+    while((len > keep) && (*str == '0')){
+        str++;
+        len--;
+    }
+    
+    nchars = len;
+    if(neg){
+        nchars++;
+    }
+    
+    if(buf_size == 0) return(nchars);
+    
+    i = 0;
+    if(neg && (buf_size > 1)){
+        buffer[i++] = '-';
+    }
+    while((len > 0) && (i < buf_size-1)){
+        buffer[i++] = *str++;
+        len--;
+    }
+    buffer[i] = 0;
+    
+    return(nchars);
+}
+
+//--------------------------------------------------------------------------------------------------
+static uint8_t print_d8(char *buffer, size_t buf_size, uint8_t num, bool neg){
+    char str[3];
+    uint8_t hi;
+    
+    // num/100. Exact for num < 1000
+    hi = ((uint16_t)num * 41) >> 12;
+    str[0] = '0' + hi;
+    put_2digits(str+1, num - hi*100);
+    
+    return(put_digits(buffer, buf_size, str, sizeof(str), neg, 1));
+}
 
 //--------------------------------------------------------------------------------------------------
+static uint8_t print_d16(char *buffer, size_t buf_size, uint16_t num, bool neg){
+    char str[5];
+    uint8_t hi;
+    
+    hi = 0;
+    while(num >= 10000){
+        num -= 10000;
+        hi++;
+    }
+    str[0] = '0' + hi;
+    put_4digits(str+1, num);
+    
+    return(put_digits(buffer, buf_size, str, sizeof(str), neg, 1));
+}
 
-#if USE_DADD_ENHANCEMENT
-    #include <msp430_xc.h>
-    static uint16_t u8_to_bcd(uint8_t n){
-        uint16_t bcd;
-        uint16_t bcd_weight;
-        
-        bcd = 0;
-        bcd_weight = 1;
-        
-        while(n){
-            if(n & 0x01){
-                bcd = __bcd_add_short(bcd, bcd_weight);
-            }
-            
-            bcd_weight = __bcd_add_short(bcd_weight,bcd_weight); // double bcd_weight
-            n >>= 1;
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Write all 10 digits of num, including leading zeros
+**/
+static void put_10digits(char *str, uint32_t num){
+    uint32_t d;
+    uint16_t q;
+    uint16_t bit;
+    
+    // num/10^8 (0-42)
+    q = 0;
+    d = 100000000UL << 5;
+    for(bit = (1 << 5); bit != 0; bit >>= 1){
+        if(num >= d){
+            num -= d;
+            q |= bit;
         }
-        
-        return(bcd);
+        d >>= 1;
+    }
+    put_2digits(str, q);
+    
+    // num/10^4 (0-9999)
+    q = 0;
+    d = 10000UL << 13;
+    for(bit = (1 << 13); bit != 0; bit >>= 1){
+        if(num >= d){
+            num -= d;
+            q |= bit;
+        }
+        d >>= 1;
     }
+    put_4digits(str+2, q);
+    put_4digits(str+6, num);
+}
 
-    //----------------------------------------------------------------------------------------------
-    static uint32_t u16_to_bcd(uint16_t n){
-        uint32_t bcd;
-        uint32_t bcd_weight;
-        
-        bcd = 0;
-        bcd_weight = 1;
-        
-        while(n){
-            if(n & 0x0001){
-                bcd = __bcd_add_long(bcd, bcd_weight);
+//--------------------------------------------------------------------------------------------------
+static uint8_t print_d32(char *buffer, size_t buf_size, uint32_t num, bool neg){
+    char str[10];
+    
+    put_10digits(str, num);
+    return(put_digits(buffer, buf_size, str, sizeof(str), neg, 1));
+}
+
+/* Fixed-point conversion
+ * The fraction is aligned to the top of a 32-bit word. Multiplying it by 10 shifts the next decimal
+ * digit out of the top, so each digit is exact. The digits are then rounded using the fraction
+ * that remains.
+ */
+
+#define Q_DIGITS_MAX    10
+
+//--------------------------------------------------------------------------------------------------
+static uint8_t print_q(char *buffer, size_t buf_size, uint32_t num, uint8_t fbits, uint8_t digits,
+                       bool neg){
+    char str[10 + 1 + Q_DIGITS_MAX];
+    uint32_t ipart;
+    uint32_t frac;
+    uint32_t f8;
+    uint8_t len;
+    uint8_t d;
+    
+    if(digits > Q_DIGITS_MAX) digits = Q_DIGITS_MAX;
+    
+    if(fbits == 0){
+        ipart = num;
+        frac = 0;
+    }else if(fbits < 32){
+        ipart = num >> fbits;
+        frac = num << (32 - fbits);
+    }else{
+        ipart = 0;
+        frac = num;
+    }
+    
+    // Fractional digits. frac*10 = frac*8 + frac*2. The part above 32 bits is the digit.
+    len = 11;
+    while(len < 11 + digits){
+        f8 = frac << 3;
+        d = (frac >> 29) + (frac >> 31);
+        frac = f8 + (frac << 1);
+        if(frac < f8) d++;
+        str[len++] = '0' + d;
+    }
+    
+    // Round to nearest, halves away from zero. A carry out of the digits goes to the integer part,
+    // which can't overflow since there is at least one fractional bit.
+    if(frac & 0x80000000UL){
+        d = len;
+        while(1){
+            d--;
+            if(d == 10){
+                ipart++;
+                break;
+            }else if(str[d] == '9'){
+                str[d] = '0';
+            }else{
+                str[d]++;
+                break;
             }
-            
-            bcd_weight = __bcd_add_long(bcd_weight,bcd_weight); // double bcd_weight
-            n >>= 1;
         }
-        
-        return(bcd);
     }
-#else
-    // MSP430 BCD add instruction not available. Use "double-dabble" method
-    static uint16_t u8_to_bcd(uint8_t n){
-        uint16_t bcd;
-        
-        uint8_t bit_mask;
-        
-        bcd = 0;
-        bit_mask = 0x80;
-        do{
-            
-            // Check all bcd digits. If a digit is greater than 4, add 3 to it.
-            uint16_t digit_mask;
-            uint16_t digit_compare;
-            uint16_t digit_add;
-            digit_mask = 0xF00;
-            digit_compare = 0x400;
-            digit_add = 0x300;
-            do{
-                if((bcd & digit_mask) > digit_compare){
-                    bcd += digit_add;
-                }
-                
-                digit_mask >>= 4;
-                digit_compare >>= 4;
-                digit_add >>= 4;
-            } while(digit_mask != 0);
-            
-            // shift upper bit of n into lower bit of bcd
-            bcd <<= 1;
-            if(n & bit_mask){
-                bcd |= 1;
-            }
-            
-            bit_mask >>= 1;
-        } while(bit_mask != 0);
-        
-        return(bcd);
+    
+    put_10digits(str, ipart);
+    if(digits){
+        str[10] = '.';
+        return(put_digits(buffer, buf_size, str, len, neg, digits + 2));
+    }else{
+        return(put_digits(buffer, buf_size, str, 10, neg, 1));
+    }
+}
+
+/* Hex dump
+ * Each row is written in a single pass. Hex digits come from a table so that no branches are
+ * needed per digit.
+ */
+
+static const char Hex_digits[16] PROGMEM = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+/**
+* \brief Write the 2 hex digits of b
+**/
+static void put_hex2(char *str, uint8_t b){
+    str[0] = pgm_read_byte(&Hex_digits[b >> 4]);
+    str[1] = pgm_read_byte(&Hex_digits[b & 0x0F]);
+}
+
+/**
+* \brief Write a hex dump row, without a null terminator
+* \return Number of characters written
+**/
+static uint8_t put_hexdump(char *str, uint32_t addr, const uint8_t *data, uint8_t len){
+    char *hex;
+    uint8_t i;
+    uint8_t c;
+    
+    put_hex2(str, addr >> 16);
+    put_hex2(str+2, addr >> 8);
+    put_hex2(str+4, addr);
+    str[6] = ' ';
+    
+    // Each byte is " XX". An extra space splits the row in two halves.
+    hex = str + 7;
+    for(i=0; i<HEXDUMP_ROW_BYTES; i++){
+        if(i == HEXDUMP_ROW_BYTES/2){
+            *hex++ = ' ';
+        }
+        hex[0] = ' ';
+        if(i < len){
+            put_hex2(hex+1, data[i]);
+        }else{
+            hex[1] = ' ';
+            hex[2] = ' ';
+        }
+        hex += 3;
     }
     
-    //----------------------------------------------------------------------------------------------
-    static uint32_t u16_to_bcd(uint16_t n){
-        uint32_t bcd;
-        
-        uint16_t bit_mask;
-        
-        bcd = 0;
-        bit_mask = 0x8000;
-        do{
-            
-            // Check all bcd digits. If a digit is greater than 4, add 3 to it.
-            uint32_t digit_mask;
-            uint32_t digit_compare;
-            uint32_t digit_add;
-            digit_mask = 0xF0000L;
-            digit_compare = 0x40000L;
-            digit_add = 0x30000L;
-            do{
-                if((bcd & digit_mask) > digit_compare){
-                    bcd += digit_add;
-                }
-                
-                digit_mask >>= 4;
-                digit_compare >>= 4;
-                digit_add >>= 4;
-            } while(digit_mask != 0);
-            
-            // shift upper bit of n into lower bit of bcd
-            bcd <<= 1;
-            if(n & bit_mask){
-                bcd |= 1;
-            }
-            
-            bit_mask >>= 1;
-        } while(bit_mask != 0);
-        
-        return(bcd);
+    hex[0] = ' ';
+    hex[1] = ' ';
+    hex[2] = '|';
+    hex += 3;
+    for(i=0; i<len; i++){
+        c = data[i];
+        if((c < ' ') || (c > '~')) c = '.';
+        *hex++ = c;
     }
+    *hex++ = '|';
+    
+    return(hex - str);
+}
+
+/* Number parsing
+ * Digits are decoded using a table that covers '0' to 'f'. Overflow is checked before each digit is
+ * added, against limits that are known at compile time.
+ */
+
+#define NOT_DIGIT   0xFF
+
+// Value of each character from '0' to 'f'. XX = not a digit
+#define XX  NOT_DIGIT
+static const uint8_t Digit_values['f'-'0'+1] PROGMEM = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  // '0' - '9'
+    XX, XX, XX, XX, XX, XX, XX,              // ':' - '@'
+    10, 11, 12, 13, 14, 15,                  // 'A' - 'F'
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,  // 'G' - 'P'
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,  // 'Q' - 'Z'
+    XX, XX, XX, XX, XX, XX,                  // '[' - '`'
+    10, 11, 12, 13, 14, 15                   // 'a' - 'f'
+};
+#undef XX
 
-#endif
+/**
+* \brief Get the value of a digit
+* \return Value of the digit, or NOT_DIGIT
+**/
+static uint8_t digit_value(char c){
+    uint8_t idx = (uint8_t)c - '0';
+    if(idx >= sizeof(Digit_values)) return(NOT_DIGIT);
+    return(pgm_read_byte(&Digit_values[idx]));
+}
 
-// 32-bit numbers always use double-dabble
-static uint64_t u32_to_bcd(uint32_t n){
-    uint64_t bcd;
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Parse hexadecimal digits
+* \param max Largest value allowed
+* \return Number of characters consumed. 0 if none or overflow.
+**/
+static uint8_t scan_hex(const char *str, uint32_t *num, uint32_t max){
+    uint32_t n = 0;
+    uint8_t i = 0;
+    uint8_t d;
+    
+    while((d = digit_value(str[i])) < 16){
+        if(n > (max >> 4)) return(0);
+        n = (n << 4) | d;
+        i++;
+        if(i == UINT8_MAX) return(0);
+    }
     
-    uint32_t bit_mask;
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Parse decimal digits
+* \param max_div10 Largest value allowed / 10
+* \param max_mod10 Largest value allowed % 10
+* \return Number of characters consumed. 0 if none or overflow.
+**/
+static uint8_t scan_dec(const char *str, uint32_t *num, uint32_t max_div10, uint8_t max_mod10){
+    uint32_t n = 0;
+    uint8_t i = 0;
+    uint8_t d;
+    
+    while((d = digit_value(str[i])) < 10){
+        if((n > max_div10) || ((n == max_div10) && (d > max_mod10))) return(0);
+        n = n*10 + d;
+        i++;
+        if(i == UINT8_MAX) return(0);
+    }
     
-    bcd = 0;
-    bit_mask = 0x80000000L;
-    do{
-        
-        // Check all bcd digits. If a digit is greater than 4, add 3 to it.
-        uint64_t digit_mask;
-        uint64_t digit_compare;
-        uint64_t digit_add;
-        digit_mask = 0xF000000000L;
-        digit_compare = 0x4000000000L;
-        digit_add = 0x3000000000L;
-        do{
-            if((bcd & digit_mask) > digit_compare){
-                bcd += digit_add;
-            }
-            
-            digit_mask >>= 4;
-            digit_compare >>= 4;
-            digit_add >>= 4;
-        } while(digit_mask != 0);
-        
-        // shift upper bit of n into lower bit of bcd
-        bcd <<= 1;
-        if(n & bit_mask){
-            bcd |= 1;
-        }
-        
-        bit_mask >>= 1;
-    } while(bit_mask != 0);
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+* \brief Parse a signed decimal number
+* \details The limits are passed in split like for scan_dec() so no division is done at run time.
+* \param pos_div10 Largest positive value allowed / 10
+* \param pos_mod10 Largest positive value allowed % 10
+* \param neg_div10 Largest negative magnitude allowed / 10
+* \param neg_mod10 Largest negative magnitude allowed % 10
+* \return Number of characters consumed. 0 if none or overflow.
+**/
+static uint8_t scan_signed(const char *str, int32_t *num, uint32_t pos_div10, uint8_t pos_mod10,
+                           uint32_t neg_div10, uint8_t neg_mod10){
+    uint32_t n;
+    uint8_t i;
+    
+    if(*str == '-'){
+        i = scan_dec(str+1, &n, neg_div10, neg_mod10);
+        if(i == 0) return(0);
+        *num = -(int32_t)(n - 1) - 1;
+        return(i+1);
+    }
     
-    return(bcd);
+    i = scan_dec(str, &n, pos_div10, pos_mod10);
+    if(i == 0) return(0);
+    *num = n;
+    return(i);
 }
 
 ///\endcond
@@ -305,131 +517,296 @@ uint8_t snprint_x32(char *buffer, size_t buf_size, uint32_t num){
 
 //--------------------------------------------------------------------------------------------------
 uint8_t snprint_d8(char *buffer, size_t buf_size, uint8_t num){
-    uint8_t i, nchars;
-    char str[3];
-    uint16_t bcd;
-    
-    i = 3; // max of 3 digits
-    
-    bcd = u8_to_bcd(num);
-    
-    do{
-        i -=1;
-        str[i]=(bcd & 0x0F) + '0';
-        bcd >>= 4;
-    }while(bcd != 0);
-    
-    nchars = 3-i;
-    
-    if(buf_size == 0) return(nchars);
-    
-    do{
-        *buffer = str[i];
-        i++;
-        buffer++;
-        if((3-i) == buf_size) return(nchars);
-    }while(i<3);
-    
-    *buffer = 0;
-    return(nchars);
+    return(print_d8(buffer, buf_size, num, false));
 }
 
 //--------------------------------------------------------------------------------------------------
 uint8_t snprint_d16(char *buffer, size_t buf_size, uint16_t num){
-    uint8_t i, nchars;
-    char str[5];
-    uint32_t bcd;
-    
-    i = 5; // max of 5 digits
-    
-    bcd = u16_to_bcd(num);
-    
-    do{
-        i -=1;
-        str[i]=(bcd & 0x0F) + '0';
-        bcd >>= 4;
-    }while(bcd != 0);
-    
-    nchars = 5-i;
-    
-    if(buf_size == 0) return(nchars);
-    
-    do{
-        *buffer = str[i];
-        i++;
-        buffer++;
-        if((5-i) == buf_size) return(nchars);
-    }while(i<5);
-    
-    *buffer = 0;
-    return(nchars);
+    return(print_d16(buffer, buf_size, num, false));
 }
 
 //--------------------------------------------------------------------------------------------------
 uint8_t snprint_d32(char *buffer, size_t buf_size, uint32_t num){
-    uint8_t i, nchars;
-    char str[10];
-    uint64_t bcd;
-    
-    i = 10; // max of 10 digits
-    
-    bcd = u32_to_bcd(num);
-    
-    do{
-        i -=1;
-        str[i]=(bcd & 0x0F) + '0';
-        bcd >>= 4;
-    }while(bcd != 0);
-    
-    nchars = 10-i;
-    
-    if(buf_size == 0) return(nchars);
-    
-    do{
-        *buffer = str[i];
-        i++;
-        buffer++;
-        if((10-i) == buf_size) return(nchars);
-    }while(i<10);
-    
-    *buffer = 0;
-    return(nchars);
+    return(print_d32(buffer, buf_size, num, false));
 }
 
 //--------------------------------------------------------------------------------------------------
 uint8_t snprint_sd8(char *buffer, size_t buf_size, int8_t num){
     if(num < 0){
-        buffer[0] = '-';
-        buffer++;
-        buf_size--;
-        return(snprint_d8(buffer,buf_size,-num)+1);
+        return(print_d8(buffer, buf_size, -(uint8_t)num, true));
     }else{
-        return(snprint_d8(buffer,buf_size,num));
+        return(print_d8(buffer, buf_size, num, false));
     }
 }
 
 //--------------------------------------------------------------------------------------------------
 uint8_t snprint_sd16(char *buffer, size_t buf_size, int16_t num){
     if(num < 0){
-        buffer[0] = '-';
-        buffer++;
-        buf_size--;
-        return(snprint_d16(buffer,buf_size,-num)+1);
+        return(print_d16(buffer, buf_size, -(uint16_t)num, true));
     }else{
-        return(snprint_d16(buffer,buf_size,num));
+        return(print_d16(buffer, buf_size, num, false));
     }
 }
 
 //--------------------------------------------------------------------------------------------------
 uint8_t snprint_sd32(char *buffer, size_t buf_size, int32_t num){
     if(num < 0){
-        buffer[0] = '-';
-        buffer++;
-        buf_size--;
-        return(snprint_d32(buffer,buf_size,-num)+1);
+        return(print_d32(buffer, buf_size, -(uint32_t)num, true));
+    }else{
+        return(print_d32(buffer, buf_size, num, false));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_q8(char *buffer, size_t buf_size, uint8_t num, uint8_t fbits, uint8_t digits){
+    return(print_q(buffer, buf_size, num, fbits, digits, false));
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_q16(char *buffer, size_t buf_size, uint16_t num, uint8_t fbits, uint8_t digits){
+    return(print_q(buffer, buf_size, num, fbits, digits, false));
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_q32(char *buffer, size_t buf_size, uint32_t num, uint8_t fbits, uint8_t digits){
+    return(print_q(buffer, buf_size, num, fbits, digits, false));
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_sq8(char *buffer, size_t buf_size, int8_t num, uint8_t fbits, uint8_t digits){
+    if(num < 0){
+        return(print_q(buffer, buf_size, (uint8_t)-num, fbits, digits, true));
     }else{
-        return(snprint_d32(buffer,buf_size,num));
+        return(print_q(buffer, buf_size, num, fbits, digits, false));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_sq16(char *buffer, size_t buf_size, int16_t num, uint8_t fbits, uint8_t digits){
+    if(num < 0){
+        return(print_q(buffer, buf_size, (uint16_t)-num, fbits, digits, true));
+    }else{
+        return(print_q(buffer, buf_size, num, fbits, digits, false));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_sq32(char *buffer, size_t buf_size, int32_t num, uint8_t fbits, uint8_t digits){
+    if(num < 0){
+        return(print_q(buffer, buf_size, -(uint32_t)num, fbits, digits, true));
+    }else{
+        return(print_q(buffer, buf_size, num, fbits, digits, false));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_field(char *buffer, size_t buf_size, const struct row_field *field, uint8_t format){
+    uint32_t num;
+    bool neg = false;
+    
+    if(format == ROW_HEX){
+        switch(field->type){
+            case ROW_U8:
+            case ROW_S8:
+                return(snprint_x8(buffer, buf_size, *(const uint8_t*)field->value));
+            case ROW_U16:
+            case ROW_S16:
+                return(snprint_x16(buffer, buf_size, *(const uint16_t*)field->value));
+            default:
+                return(snprint_x32(buffer, buf_size, *(const uint32_t*)field->value));
+        }
+    }
+    
+    // Load the value, then split off the sign
+    switch(field->type){
+        case ROW_U8:
+            num = *(const uint8_t*)field->value;
+            break;
+        case ROW_U16:
+            num = *(const uint16_t*)field->value;
+            break;
+        case ROW_U32:
+            num = *(const uint32_t*)field->value;
+            break;
+        case ROW_S8:
+            num = (int32_t)*(const int8_t*)field->value;
+            break;
+        case ROW_S16:
+            num = (int32_t)*(const int16_t*)field->value;
+            break;
+        default:
+            num = *(const int32_t*)field->value;
+            break;
     }
+    if((field->type >= ROW_S8) && ((int32_t)num < 0)){
+        num = -num;
+        neg = true;
+    }
+    
+    if(field->fbits || field->digits){
+        return(print_q(buffer, buf_size, num, field->fbits, field->digits, neg));
+    }else if(num <= UINT8_MAX){
+        return(print_d8(buffer, buf_size, num, neg));
+    }else if(num <= UINT16_MAX){
+        return(print_d16(buffer, buf_size, num, neg));
+    }else{
+        return(print_d32(buffer, buf_size, num, neg));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+size_t snprint_row(char *buffer, size_t buf_size, const struct row_field *fields, uint8_t count,
+                   uint8_t format, char sep){
+    char tmp[ROW_FIELD_LEN_MAX+1];
+    size_t len = 0;
+    uint8_t n;
+    uint8_t i;
+    
+    while(count){
+        if((len < buf_size) && (buf_size - len > ROW_FIELD_LEN_MAX)){
+            // Fits. Convert in place
+            len += snprint_field(buffer + len, buf_size - len, fields, format);
+        }else{
+            n = snprint_field(tmp, sizeof(tmp), fields, format);
+            for(i=0; i<n; i++){
+                if(len + 1 < buf_size) buffer[len] = tmp[i];
+                len++;
+            }
+        }
+        fields++;
+        count--;
+        
+        if(sep && count){
+            if(len + 1 < buf_size) buffer[len] = sep;
+            len++;
+        }
+    }
+    
+    if(buf_size){
+        buffer[(len < buf_size) ? len : (buf_size - 1)] = 0;
+    }
+    
+    return(len);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t snprint_hexdump(char *buffer, size_t buf_size, uint32_t addr, const uint8_t *data,
+                        uint8_t len){
+    char tmp[HEXDUMP_ROW_LEN_MAX];
+    uint8_t n;
+    uint8_t i;
+    
+    if(len > HEXDUMP_ROW_BYTES) len = HEXDUMP_ROW_BYTES;
+    
+    if(buf_size > HEXDUMP_ROW_LEN_MAX){
+        n = put_hexdump(buffer, addr, data, len);
+        buffer[n] = 0;
+        return(n);
+    }
+    
+    n = put_hexdump(tmp, addr, data, len);
+    if(buf_size == 0) return(n);
+    for(i=0; (i < n) && (i < buf_size-1); i++){
+        buffer[i] = tmp[i];
+    }
+    buffer[i] = 0;
+    return(n);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_x8(const char *str, uint8_t *num){
+    uint32_t n;
+    uint8_t i;
+    
+    i = scan_hex(str, &n, UINT8_MAX);
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_x16(const char *str, uint16_t *num){
+    uint32_t n;
+    uint8_t i;
+    
+    i = scan_hex(str, &n, UINT16_MAX);
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_x32(const char *str, uint32_t *num){
+    return(scan_hex(str, num, UINT32_MAX));
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_hex_n(const char *str, uint8_t digits, uint32_t *num){
+    uint32_t n = 0;
+    uint8_t i;
+    uint8_t d;
+    
+    if(digits > sizeof(n)*2) digits = sizeof(n)*2;
+    
+    for(i=0; i<digits; i++){
+        d = digit_value(str[i]);
+        if(d >= 16) break;
+        n = (n << 4) | d;
+    }
+    
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_d8(const char *str, uint8_t *num){
+    uint32_t n;
+    uint8_t i;
+    
+    i = scan_dec(str, &n, UINT8_MAX/10, UINT8_MAX%10);
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_d16(const char *str, uint16_t *num){
+    uint32_t n;
+    uint8_t i;
+    
+    i = scan_dec(str, &n, UINT16_MAX/10, UINT16_MAX%10);
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_d32(const char *str, uint32_t *num){
+    return(scan_dec(str, num, UINT32_MAX/10, UINT32_MAX%10));
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_sd8(const char *str, int8_t *num){
+    int32_t n;
+    uint8_t i;
+    
+    i = scan_signed(str, &n, INT8_MAX/10, INT8_MAX%10,
+                    (INT8_MAX+1UL)/10, (INT8_MAX+1UL)%10);
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_sd16(const char *str, int16_t *num){
+    int32_t n;
+    uint8_t i;
+    
+    i = scan_signed(str, &n, INT16_MAX/10, INT16_MAX%10,
+                    (INT16_MAX+1UL)/10, (INT16_MAX+1UL)%10);
+    if(i) *num = n;
+    return(i);
+}
+
+//--------------------------------------------------------------------------------------------------
+uint8_t scan_sd32(const char *str, int32_t *num){
+    return(scan_signed(str, num, INT32_MAX/10, INT32_MAX%10,
+                       (INT32_MAX+1UL)/10, (INT32_MAX+1UL)%10));
 }
 
 ///\}
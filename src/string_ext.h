@@ -145,6 +145,286 @@ uint8_t snprint_sd16(char *buffer, size_t buf_size, int16_t num);
 **/
 uint8_t snprint_sd32(char *buffer, size_t buf_size, int32_t num);
 
+/**
+* \brief Converts an unsigned 8-bit fixed-point number into a decimal string
+* \details The fraction is rounded to \c digits places, to nearest with halves away from zero.
+*     eg: 0x18 with 4 fractional bits and 2 digits is "1.50"
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] num Fixed-point number to be converted
+* \param [in] fbits Number of fractional bits in \c num (0 to 8)
+* \param [in] digits Number of digits after the decimal point (0 to 10). 0 omits the point.
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_q8(char *buffer, size_t buf_size, uint8_t num, uint8_t fbits, uint8_t digits);
+
+/**
+* \brief Converts an unsigned 16-bit fixed-point number into a decimal string
+* \details The fraction is rounded to \c digits places, to nearest with halves away from zero.
+*     eg: 0x18 with 4 fractional bits and 2 digits is "1.50"
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] num Fixed-point number to be converted
+* \param [in] fbits Number of fractional bits in \c num (0 to 16)
+* \param [in] digits Number of digits after the decimal point (0 to 10). 0 omits the point.
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_q16(char *buffer, size_t buf_size, uint16_t num, uint8_t fbits, uint8_t digits);
+
+/**
+* \brief Converts an unsigned 32-bit fixed-point number into a decimal string
+* \details The fraction is rounded to \c digits places, to nearest with halves away from zero.
+*     eg: 0x18 with 4 fractional bits and 2 digits is "1.50"
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] num Fixed-point number to be converted
+* \param [in] fbits Number of fractional bits in \c num (0 to 32)
+* \param [in] digits Number of digits after the decimal point (0 to 10). 0 omits the point.
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_q32(char *buffer, size_t buf_size, uint32_t num, uint8_t fbits, uint8_t digits);
+
+/**
+* \brief Converts a signed 8-bit fixed-point number into a decimal string
+* \details The fraction is rounded to \c digits places, to nearest with halves away from zero.
+*     eg: 0x18 with 4 fractional bits and 2 digits is "1.50"
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] num Fixed-point number to be converted
+* \param [in] fbits Number of fractional bits in \c num (0 to 8)
+* \param [in] digits Number of digits after the decimal point (0 to 10). 0 omits the point.
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_sq8(char *buffer, size_t buf_size, int8_t num, uint8_t fbits, uint8_t digits);
+
+/**
+* \brief Converts a signed 16-bit fixed-point number into a decimal string
+* \details The fraction is rounded to \c digits places, to nearest with halves away from zero.
+*     eg: 0x18 with 4 fractional bits and 2 digits is "1.50"
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] num Fixed-point number to be converted
+* \param [in] fbits Number of fractional bits in \c num (0 to 16)
+* \param [in] digits Number of digits after the decimal point (0 to 10). 0 omits the point.
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_sq16(char *buffer, size_t buf_size, int16_t num, uint8_t fbits, uint8_t digits);
+
+/**
+* \brief Converts a signed 32-bit fixed-point number into a decimal string
+* \details The fraction is rounded to \c digits places, to nearest with halves away from zero.
+*     eg: 0x18 with 4 fractional bits and 2 digits is "1.50"
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] num Fixed-point number to be converted
+* \param [in] fbits Number of fractional bits in \c num (0 to 32)
+* \param [in] digits Number of digits after the decimal point (0 to 10). 0 omits the point.
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_sq32(char *buffer, size_t buf_size, int32_t num, uint8_t fbits, uint8_t digits);
+
+/// Type of the value a \ref row_field points to
+enum row_type{
+    ROW_U8, ROW_U16, ROW_U32,
+    ROW_S8, ROW_S16, ROW_S32
+};
+
+/// Number format used by snprint_row()
+enum row_format{
+    ROW_DEC,    ///< Decimal. Fields with \c fbits or \c digits set are printed as fixed-point.
+    ROW_HEX     ///< Hexadecimal with all digits of the value's width. (eg: an int16_t -1 is "FFFF")
+};
+
+/// Longest string that a single row field can produce
+#define ROW_FIELD_LEN_MAX   22
+
+/**
+ * \brief Describes one field of a row
+ **/
+struct row_field{
+    const void *value;  ///< Pointer to the value
+    uint8_t type;       ///< Type of the value. (\ref row_type)
+    uint8_t fbits;      ///< Number of fractional bits if the value is fixed-point. Otherwise 0.
+    uint8_t digits;     ///< Number of digits after the decimal point. (0 to 10)
+};
+
+/**
+* \brief Converts a single row field into a string
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] field Pointer to the field to convert
+* \param [in] format Number format. (\ref row_format)
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_field(char *buffer, size_t buf_size, const struct row_field *field, uint8_t format);
+
+/**
+* \brief Converts an array of fields into a single row, such as a line of a CSV file
+* \details Fields are converted directly into \c buffer in one pass. No line ending is added.
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] fields Array of fields
+* \param [in] count Number of fields
+* \param [in] format Number format. (\ref row_format)
+* \param [in] sep Separator between fields. 0 for none.
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+size_t snprint_row(char *buffer, size_t buf_size, const struct row_field *fields, uint8_t count,
+                   uint8_t format, char sep);
+
+/// Number of bytes in a full hex dump row
+#define HEXDUMP_ROW_BYTES   16
+
+/// Length of a full hex dump row
+#define HEXDUMP_ROW_LEN_MAX (60 + HEXDUMP_ROW_BYTES)
+
+/**
+* \brief Converts up to 16 bytes into a hex dump row
+* \details The row shows the address, the bytes in hex, and the bytes as ASCII. Bytes that are not
+*     printable are shown as '.'. Short rows are padded so the ASCII column stays aligned.
+*     eg: <tt>"01F3A0  48 65 6C 6C 6F 0A 00 FF  ...  |Hello...........|"</tt>
+* \param [out] buffer Pointer to a character string to write to. Outputs null-terminated string
+* \param [in] buf_size Up to buf_size - 1 characters may be written, plus the null terminator
+* \param [in] addr Address of the first byte. Printed as 6 hex digits.
+* \param [in] data Bytes to convert
+* \param [in] len Number of bytes (1 to 16)
+* \return Number of characters written if successful. If the resulting string gets truncated due to 
+*     \c buf_size limit, function returns the total number of characters (not including the
+*     terminating null-byte) which would have been written, if the limit was not imposed.
+**/
+uint8_t snprint_hexdump(char *buffer, size_t buf_size, uint32_t addr, const uint8_t *data,
+                        uint8_t len);
+
+/**
+* \brief Parses a hexadecimal string into an 8-bit integer
+* \details Parsing stops at the first character that is not a digit. The caller can check that
+*     the character after the consumed ones is the expected delimiter (e.g. null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_x8(const char *str, uint8_t *num);
+
+/**
+* \brief Parses a hexadecimal string into a 16-bit integer
+* \details Parsing stops at the first character that is not a digit. The caller can check that
+*     the character after the consumed ones is the expected delimiter (e.g. null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_x16(const char *str, uint16_t *num);
+
+/**
+* \brief Parses a hexadecimal string into a 32-bit integer
+* \details Parsing stops at the first character that is not a digit. The caller can check that
+*     the character after the consumed ones is the expected delimiter (e.g. null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_x32(const char *str, uint32_t *num);
+
+/**
+* \brief Parses up to a fixed number of hexadecimal digits into an integer
+* \details For fields that are not delimited. (e.g. Intel HEX records) Parsing stops after \c digits
+*     characters, or at the first character that is not a digit. Characters after a null
+*     terminator are never read.
+* \param [in] str String to parse
+* \param digits Maximum number of digits to parse. At most 8.
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit.
+**/
+uint8_t scan_hex_n(const char *str, uint8_t digits, uint32_t *num);
+
+/**
+* \brief Parses an unsigned decimal string into an 8-bit integer
+* \details Parsing stops at the first character that is not a digit. The caller can check that
+*     the character after the consumed ones is the expected delimiter (e.g. null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_d8(const char *str, uint8_t *num);
+
+/**
+* \brief Parses an unsigned decimal string into a 16-bit integer
+* \details Parsing stops at the first character that is not a digit. The caller can check that
+*     the character after the consumed ones is the expected delimiter (e.g. null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_d16(const char *str, uint16_t *num);
+
+/**
+* \brief Parses an unsigned decimal string into a 32-bit integer
+* \details Parsing stops at the first character that is not a digit. The caller can check that
+*     the character after the consumed ones is the expected delimiter (e.g. null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_d32(const char *str, uint32_t *num);
+
+/**
+* \brief Parses a signed decimal string into an 8-bit integer
+* \details A leading '-' is allowed. Parsing stops at the first character that is not a digit. The
+*     caller can check that the character after the consumed ones is the expected delimiter (e.g.
+*     null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_sd8(const char *str, int8_t *num);
+
+/**
+* \brief Parses a signed decimal string into a 16-bit integer
+* \details A leading '-' is allowed. Parsing stops at the first character that is not a digit. The
+*     caller can check that the character after the consumed ones is the expected delimiter (e.g.
+*     null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_sd16(const char *str, int16_t *num);
+
+/**
+* \brief Parses a signed decimal string into a 32-bit integer
+* \details A leading '-' is allowed. Parsing stops at the first character that is not a digit. The
+*     caller can check that the character after the consumed ones is the expected delimiter (e.g.
+*     null terminator).
+* \param [in] str String to parse
+* \param [out] num Parsed value. Unchanged if the function returns 0.
+* \return Number of characters consumed. 0 if \c str does not start with a digit, or if the value
+*     does not fit in \c num.
+**/
+uint8_t scan_sd32(const char *str, int32_t *num);
+
 #ifdef __cplusplus
 }
 #endif
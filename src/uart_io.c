@@ -88,6 +88,127 @@
     #endif
 #endif
 
+#if(UART_AUTOBAUD_EN == 1)
+    #define AUTOBAUD
+    // Longest time to wait for an edge of the sync character. (2 bits at the slowest rate)
+    #define AUTOBAUD_TIMEOUT_OVF    ((F_CPU * 2 / AUTOBAUD_MIN_RATE) >> 16)
+#endif
+
+#if(RX_FLOW_CONTROL_EN == 1)
+    #ifdef RXMODE_POLL
+        #error "RX flow control is not supported in polling mode"
+    #endif
+    #define RX_FLOW_CTL
+    #define RXFC_PIN_bm (1 << RX_FLOW_PIN)
+    #if(RX_FLOW_LOW >= RX_FLOW_HIGH)
+        #error "RX_FLOW_LOW must be less than RX_FLOW_HIGH"
+    #endif
+#endif
+
+// In DMA mode, RX_Buf is filled as one or more DMA blocks. An interrupt occurs after each one.
+#if defined(RX_FLOW_CTL) && defined(RXMODE_DMA)
+    #define RX_DMA_SEGMENTS RX_FLOW_DMA_SEGMENTS
+#else
+    #define RX_DMA_SEGMENTS 1
+#endif
+#define RX_DMA_SEG_SIZE (RX_BUF_SIZE / RX_DMA_SEGMENTS)
+#if((RX_DMA_SEG_SIZE * RX_DMA_SEGMENTS) != RX_BUF_SIZE)
+    #error "RX_BUF_SIZE must be a multiple of RX_FLOW_DMA_SEGMENTS"
+#endif
+
+// DMA buffer indexes and transfer counts are only 16-bit if the sizes require it
+#ifdef RXMODE_DMA
+    #if(RX_BUF_SIZE > 32768)
+        #error "RX_BUF_SIZE must not exceed 32768 in DMA mode"
+    #endif
+    #if(RX_BUF_SIZE > 256)
+        typedef uint16_t rx_idx_t;
+    #else
+        typedef uint8_t rx_idx_t;
+    #endif
+    #if(RX_DMA_SEG_SIZE > 256)
+        typedef uint16_t rx_cnt_t;
+    #else
+        typedef uint8_t rx_cnt_t;
+    #endif
+#endif
+
+#ifdef TXMODE_DMA
+    #if(TX_BUF_SIZE > 32768)
+        #error "TX_BUF_SIZE must not exceed 32768 in DMA mode"
+    #endif
+    #if(TX_BUF_SIZE > 256)
+        #define TX_DMA_WIDE
+        typedef uint16_t tx_idx_t;
+    #else
+        typedef uint8_t tx_idx_t;
+    #endif
+#endif
+
+#if(RX_EVENT_EN == 1)
+    #ifdef RXMODE_POLL
+        #error "RX events are not supported in polling mode"
+    #endif
+    #define RX_EVENT
+    #include "event_queue.h"
+    #include "rtc.h"
+    #if(RTC_TIMER_ENABLE == 0)
+        #error "RX events require RTC_TIMER_ENABLE"
+    #endif
+#endif
+
+#if defined(RXMODE_DMA) && (RX_ASYNC_EVENT_EN == 1)
+    #define RX_ASYNC_EVENT
+    #include "event_queue.h"
+#endif
+
+#if(RS485_EN == 1)
+    #ifdef TXMODE_POLL
+        #error "RS-485 mode is not supported in TX polling mode"
+    #endif
+    #ifdef RXMODE_POLL
+        #error "RS-485 mode is not supported in RX polling mode"
+    #endif
+    #define RS485
+    #define DE_PIN_bm (1 << RS485_DE_PIN)
+#endif
+
+#if(UART_LINE_EN == 1)
+    #ifndef RXMODE_INTR
+        #error "Line discipline is only supported in RX interrupt mode"
+    #endif
+    #define UART_LINE
+#endif
+
+#if(UART_MPCM_EN == 1)
+    #ifndef RXMODE_INTR
+        #error "Multi-processor communication mode is only supported in RX interrupt mode"
+    #endif
+    #define MPCM
+#endif
+
+#if(TX_COALESCE_EN == 1)
+    #ifndef TXMODE_DMA
+        #error "TX coalescing is only supported in DMA mode"
+    #endif
+    #define TX_COALESCE
+    #include "rtc.h"
+    #if(RTC_TIMER_ENABLE == 0)
+        #error "TX coalescing requires RTC_TIMER_ENABLE"
+    #endif
+#endif
+
+#if(UART_STATS_EN == 1)
+    #define UART_STATS
+    #define STATS_ADD(field, n)     (Stats.field += (n))
+    #define STATS_PEAK(field, n)    do{if((n) > Stats.field) Stats.field = (n);}while(0)
+    #define STATS_RX_CHAR(status)   stats_rx_char(status)
+#else
+    #define STATS_ADD(field, n)
+    #define STATS_PEAK(field, n)
+    #define STATS_RX_CHAR(status)
+#endif
+
 //==================================================================================================
 // Variable Declarations
 //==================================================================================================
@@ -97,10 +218,29 @@
     static FIFO_t RXFIFO;
 #endif
 
+#ifdef UART_LINE
+    // RXFIFO only contains whole lines. Each is stored as its 16-bit length followed by its
+    // characters, and may wrap around the end of rxbuf. The line being assembled follows at
+    // RXFIFO.wridx. Its length is filled in and it is added to RXFIFO once it is complete.
+    #define RX_LINE_HDR 2
+    static size_t RX_line_idx; // Write index of the next character of the line being assembled
+    static size_t RX_line_len; // Length of the line being assembled
+    static bool RX_line_cr; // Previous character was a CR
+#endif
+
 #ifdef RXMODE_DMA
     static uint8_t RX_Buf[RX_BUF_SIZE] __attribute__ ((section (".noinit")));
     static volatile int8_t RX_laplead; // Number of buffer laps the DMA wridx is leading RX_rdidx by. Should be 0 or 1
-    static uint8_t RX_rdidx;
+    static rx_idx_t RX_rdidx;
+    #if(RX_DMA_SEGMENTS > 1)
+        static volatile uint8_t RX_segidx; // DMA block within RX_Buf that is currently being filled
+    #endif
+    static volatile bool RX_async; // uart_read_async() stopped the ring. Block ISR doesn't re-enable
+    static volatile bool RX_async_active; // RX DMA channel is writing into the caller's buffer
+    static volatile bool RX_async_copy; // uart_read_async() is still copying RX_Buf into buf
+    static volatile bool RX_async_pending; // Callback is waiting in the event queue
+    static uint16_t RX_async_len;
+    static void (*RX_async_callback)(void);
 #endif
 
 #ifdef TXMODE_INTR
@@ -108,37 +248,118 @@
     static FIFO_t TXFIFO;
 #endif
 
+#ifdef TXMODE_POLL
+    static char TX_stage[16]; // Holds data from uart_tx_reserve() until it is committed
+#endif
+
 #ifdef TXMODE_DMA
     static uint8_t TX_Buf[TX_BUF_SIZE] __attribute__ ((section (".noinit")));
-    static uint8_t TX_transfer_idx; // Start index of the current DMA transfer
-    static uint8_t TX_transfer_len; // Length of the current DMA transfer
-    static uint8_t TX_wridx;
+    static tx_idx_t TX_transfer_idx; // Start index of the current DMA transfer
+    static tx_idx_t TX_transfer_len; // Length of the current DMA transfer
+    static tx_idx_t TX_wridx;
+    #ifndef RS485
+        static volatile bool TX_txc_wait; // A transfer started since uart_flush() last saw TXCIF
+    #endif
+    #ifdef TX_COALESCE
+        static timer_t TX_coalesce_timer;
+        static volatile bool TX_coalesce_timer_running;
+    #endif
+#endif
+
+#ifdef RX_EVENT
+    static struct uart_rx_eventctl RX_event; // handler == NULL if events are stopped
+    static timer_t RX_event_timer;
+    static bool RX_event_timer_running;
+    static volatile bool RX_event_pending; // Event is waiting in the event queue
+    static volatile bool RX_event_active; // Data was received since the last timer tick
+    static bool RX_event_idle_armed; // Cleared once an idle event was posted for the current burst
+    static uint16_t RX_event_interval; // Timer interval in RTC ticks
+    static uint16_t RX_event_quiet; // RTC ticks without received data
+    #ifdef RXMODE_DMA
+        static rx_idx_t RX_event_scanidx; // Next RX_Buf index to check for the delimiter
+    #endif
+#endif
+
+#ifdef RS485
+    static volatile bool DE_asserted;
+#endif
+
+#ifdef MPCM
+    static int16_t MPCM_address; // Own node address. -1 if address filtering is disabled
+#endif
+
+#ifdef UART_STATS
+    static struct uart_stats Stats;
+    #ifdef TX_FLOW_CTL
+        static uint16_t Stats_cts_start; // Timestamp when CTS stopped TX
+    #endif
+    #ifdef RS485
+        static uint16_t Stats_de_start; // Timestamp when DE was asserted
+    #endif
 #endif
 
 //==================================================================================================
 // Functions
 //==================================================================================================
 
+#ifdef RXMODE_DMA
+    /**
+    * \brief Point the RX DMA channel at the start of an empty RX_Buf and enable it
+    **/
+    static void rx_dma_ring_start(void){
+        #if(RX_DMA_SEGMENTS > 1)
+            // RX_Buf is split into several blocks. Address is reloaded manually once the last one
+            // completes.
+            EDMA.RX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_NONE_gc | EDMA_CH_DIR_INC_gc;
+            RX_segidx = 0;
+        #else
+            EDMA.RX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_BLOCK_gc | EDMA_CH_DIR_INC_gc;
+        #endif
+        EDMA.RX_DMA_CH.TRFCNTL = (RX_DMA_SEG_SIZE & 0xFF);
+        EDMA.RX_DMA_CH.TRFCNTH = (RX_DMA_SEG_SIZE > 256) ? (RX_DMA_SEG_SIZE >> 8) : 0;
+        EDMA.RX_DMA_CH.ADDRL = ((uintptr_t)(&RX_Buf)) & 0xFF;
+        EDMA.RX_DMA_CH.ADDRH = ((uintptr_t)(&RX_Buf)) >> 8;
+        
+        EDMA.RX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
+        RX_laplead = 0;
+        RX_rdidx = 0;
+        #ifdef RX_EVENT
+            RX_event_scanidx = 0;
+        #endif
+    }
+#endif
+
+//--------------------------------------------------------------------------------------------------
 void uart_init(void){
     // Clear UART
     UART_DEV.CTRLA = 0;
     UART_DEV.CTRLB = 0;
     
     #if defined(RXMODE_DMA) || defined(TXMODE_DMA)
-        // Setup EDMA
-        EDMA.CTRL = EDMA_RESET_bm;
-        EDMA.CTRL = EDMA_ENABLE_bm;
+        // Enable the EDMA controller without disturbing channels used by other modules. The
+        // channels must be separate peripheral channels without double buffering.
+        EDMA.CTRL = (EDMA.CTRL & ~(EDMA_CHMODE_gm | EDMA_DBUFMODE_gm))
+                    | EDMA_CHMODE_PER0123_gc | EDMA_DBUFMODE_DISABLE_gc | EDMA_ENABLE_bm;
     #endif
     
     #ifdef RXMODE_INTR
         fifo_init(&RXFIFO, rxbuf, sizeof(rxbuf));
         UART_DEV.CTRLA = RX_ISR_INTLVL;
+        #ifdef UART_LINE
+            RX_line_idx = RX_LINE_HDR;
+            RX_line_len = 0;
+            RX_line_cr = false;
+        #endif
     #endif
     
     #ifdef TXMODE_INTR
         fifo_init(&TXFIFO, txbuf, sizeof(txbuf));
     #endif
     
+    #ifdef UART_STATS
+        memset(&Stats, 0, sizeof(Stats));
+    #endif
+    
     #ifdef RXMODE_DMA
         /* Init RX DMA Channel
          * 
@@ -150,16 +371,11 @@ void uart_init(void){
         EDMA.RX_DMA_CH.CTRLA = EDMA_CH_RESET_bm;
         EDMA.RX_DMA_CH.CTRLA = EDMA_CH_SINGLE_bm; // No repeat. DMA is restarted in the interrupt after each block.
         EDMA.RX_DMA_CH.CTRLB = RX_DMA_INTLVL;
-        EDMA.RX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_BLOCK_gc | EDMA_CH_DIR_INC_gc;
         EDMA.RX_DMA_CH.TRIGSRC = RX_DMA_TRIGSRC;
-        EDMA.RX_DMA_CH.TRFCNTL = (RX_BUF_SIZE & 0xFF);
-        EDMA.RX_DMA_CH.TRFCNTH = 0;
-        EDMA.RX_DMA_CH.ADDRL = ((uintptr_t)(&RX_Buf)) & 0xFF;
-        EDMA.RX_DMA_CH.ADDRH = ((uintptr_t)(&RX_Buf)) >> 8;
-        
-        EDMA.RX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
-        RX_laplead = 0;
-        RX_rdidx = 0;
+        RX_async = false;
+        RX_async_active = false;
+        RX_async_pending = false;
+        rx_dma_ring_start();
     #endif
     
     #ifdef TXMODE_DMA
@@ -181,6 +397,9 @@ void uart_init(void){
         TX_transfer_idx = 0;
         TX_transfer_len = 0;
         TX_wridx = 0;
+        #ifndef RS485
+            TX_txc_wait = false;
+        #endif
     #endif
     
     // setbaud.h inline include calculates BAUDCTRL values
@@ -195,10 +414,30 @@ void uart_init(void){
     #endif
     #undef BAUD
     
-    UART_DEV.CTRLC = USART_CHSIZE_8BIT_gc;
+    #ifdef MPCM
+        // 9-bit frames. Ignore data frames until an address frame for this node is received.
+        UART_DEV.CTRLC = USART_CHSIZE_9BIT_gc;
+        UART_DEV.CTRLB |= USART_MPCM_bm;
+        MPCM_address = UART_MPCM_ADDRESS;
+    #else
+        UART_DEV.CTRLC = USART_CHSIZE_8BIT_gc;
+    #endif
     // Enable UART!
     UART_DEV.CTRLB |= USART_RXEN_bm | USART_TXEN_bm;
     
+    // RS-485 driver is disabled until there is something to send
+    #ifdef RS485
+        RS485_DE_PORT.OUTCLR = DE_PIN_bm;
+        RS485_DE_PORT.DIRSET = DE_PIN_bm;
+        DE_asserted = false;
+    #endif
+    
+    // Set up RX flow control. Ready to receive.
+    #ifdef RX_FLOW_CTL
+        RX_FLOW_PORT.OUTCLR = RXFC_PIN_bm;
+        RX_FLOW_PORT.DIRSET = RXFC_PIN_bm;
+    #endif
+    
     // Set up TX flow control
     #ifdef TX_FLOW_CTL
         TX_FLOW_PORT.DIRCLR = TXFC_PIN_bm; // ensure pin is input
@@ -223,6 +462,17 @@ void uart_uninit(void){
         TX_FLOW_PORT.INTCTRL &= ~TXFC_INTLVL_gm;
     #endif
     
+    #ifdef RX_EVENT
+        uart_rx_event_stop();
+    #endif
+    
+    #ifdef TX_COALESCE
+        if(TX_coalesce_timer_running){
+            timer_stop(&TX_coalesce_timer);
+            TX_coalesce_timer_running = false;
+        }
+    #endif
+    
     // Disable interrupts
     UART_DEV.CTRLA = 0;
     
@@ -248,166 +498,762 @@ void uart_uninit(void){
     }
     UART_DEV_PORT.DIRSET = UART_TXPIN;
     UART_DEV_PORT.OUTSET = UART_TXPIN;
+    
+    #ifdef RX_FLOW_CTL
+        // No longer receiving. Request sender to stop.
+        RX_FLOW_PORT.OUTSET = RXFC_PIN_bm;
+    #endif
+    
+    #ifdef RS485
+        // TX is finished. Release the bus.
+        RS485_DE_PORT.OUTCLR = DE_PIN_bm;
+        DE_asserted = false;
+    #endif
 }
 
 //==================================================================================================
-//                                          RX Functions
+//                                          Baud Rate Functions
 //==================================================================================================
-#ifdef RXMODE_DMA
-    ISR(RX_DMA_VECTOR){
-        // RX DMA has wrapped around RX_Buf
-        
-        RX_laplead++;
-        
-        // Clear flags
-        EDMA.RX_DMA_CH.CTRLB |= EDMA_CH_TRNIF_bm | EDMA_CH_ERRIF_bm;
-        
-        // Re-enable DMA manually because Atmel is a silly goose.
-        EDMA.RX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
-    }
-#endif
-
-#ifdef RXMODE_INTR
-    ISR(RX_ISR_VECTOR){
-        uint8_t c;
-        c = UART_DEV.DATA;
-        fifo_write(&RXFIFO, &c, 1);
-    }
-#endif
-
-//--------------------------------------------------------------------------------------------------
-size_t uart_rdcount(void){
-    #ifdef RXMODE_POLL
-        if(UART_DEV.STATUS & USART_RXCIF_bm){
-            return(1);
-        }else{
-            return(0);
-        }
-    #endif
+uint32_t uart_set_baud(uint32_t rate){
+    uint32_t best_rate = 0;
+    uint32_t best_err = UINT32_MAX;
+    uint16_t best_bsel = 0;
+    int8_t best_bscale = 0;
+    uint8_t best_clk2x = 0;
+    uint8_t clk2x;
+    int8_t bscale;
     
-    #ifdef RXMODE_INTR
-        return(fifo_rdcount(&RXFIFO));
-    #endif
+    if((rate == 0) || (rate > F_CPU/8)){
+        // Out of range even with CLK2X
+        return(0);
+    }
     
-    #ifdef RXMODE_DMA
-        uint8_t trfcnt;
-        int8_t laplead;
-        uint8_t wridx;
-        
-        // get snapshot of DMA buffer status
-        do{
-            laplead = RX_laplead;
-            trfcnt = EDMA.RX_DMA_CH.TRFCNTL;
-        }while(laplead != RX_laplead); //if laplead changed, may be invalid. try again
-        
-        // Calculate DMA's wridx
-        wridx = sizeof(RX_Buf) - trfcnt;
+    // Exhaustively search all BSCALE values, with and without CLK2X, for the closest rate.
+    // Without CLK2X is tried first so that it is preferred if both are equally good.
+    for(clk2x=0; clk2x<2; clk2x++){
+        uint32_t div = clk2x ? 8 : 16; // Samples per bit
         
-        if((laplead == 0) && (wridx >= RX_rdidx)){
-            // Data doesn't wrap
-            return(wridx - RX_rdidx);
+        for(bscale=-7; bscale<=7; bscale++){
+            uint32_t bsel, actual, err, den;
             
-        }else if(((laplead == 1) && (wridx <= RX_rdidx)) || ((laplead == 0) && (wridx < RX_rdidx))){
-            // Available data wraps.
-            return(wridx + sizeof(RX_Buf) - RX_rdidx);
-        }else{
-            // Overrun!
+            if(bscale >= 0){
+                // rate = F_CPU / (2^BSCALE * div * (BSEL + 1))
+                if((div*rate) > (F_CPU >> bscale)) continue;
+                den = (div*rate) << bscale;
+                bsel = (F_CPU + den/2) / den;
+                if(bsel == 0) continue;
+                bsel -= 1;
+                if(bsel > 4095) continue;
+                den = (div << bscale) * (bsel + 1);
+                actual = (F_CPU + den/2) / den;
+            }else{
+                // rate = F_CPU / (div * (2^BSCALE * BSEL + 1))
+                // F_CPU << 7 fits in 32 bits for all XMEGA clock speeds
+                uint8_t s = -bscale;
+                den = div*rate;
+                bsel = (((uint32_t)F_CPU << s) + den/2) / den;
+                if(bsel < (1UL << s)) continue;
+                bsel -= (1UL << s);
+                if(bsel > 4095) continue;
+                den = div * (bsel + (1UL << s));
+                actual = (((uint32_t)F_CPU << s) + den/2) / den;
+            }
             
-            // Move read pointer to a safe position
-            RX_rdidx = wridx;
-            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-                RX_laplead -= laplead;
+            if(actual > rate){
+                err = actual - rate;
+            }else{
+                err = rate - actual;
             }
             
-            return(0);
+            if(err < best_err){
+                best_err = err;
+                best_rate = actual;
+                best_bsel = bsel;
+                best_bscale = bscale;
+                best_clk2x = clk2x;
+            }
         }
-    #endif
+    }
+    
+    // Writing BAUDCTRLA updates the baud rate. BAUDCTRLB must be written first.
+    UART_DEV.BAUDCTRLB = (((uint8_t)best_bscale) << USART_BSCALE_gp) | (best_bsel >> 8);
+    UART_DEV.BAUDCTRLA = best_bsel & 0xFF;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        // Interrupts may also modify CTRLB
+        if(best_clk2x){
+            UART_DEV.CTRLB |= USART_CLK2X_bm;
+        }else{
+            UART_DEV.CTRLB &= ~USART_CLK2X_bm;
+        }
+    }
+    
+    return(best_rate);
 }
 
-
 //--------------------------------------------------------------------------------------------------
-void uart_rdflush(void){
-    #ifdef RXMODE_POLL
-        // Clear flag
-        UART_DEV.STATUS = USART_RXCIF_bm;
-    #endif
-    
-    #ifdef RXMODE_INTR
-        fifo_clear(&RXFIFO);
-    #endif
+#ifdef AUTOBAUD
+    static uint16_t AB_ovf; // Upper 16 bits of the autobaud timestamp
     
-    #ifdef RXMODE_DMA
-        uint8_t trfcnt;
-        uint8_t wridx;
+    /**
+    * \brief Busy-wait until the RX pin reaches a level
+    * \param high Level to wait for
+    * \param [out] timestamp Time when the level was detected in F_CPU cycles
+    * \retval true OK
+    * \retval false Timed out
+    **/
+    static bool ab_wait_pin(bool high, uint32_t *timestamp){
+        uint16_t start_ovf = AB_ovf;
+        uint16_t cnt;
         
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-            trfcnt = EDMA.RX_DMA_CH.TRFCNTL;
+        while(((UART_DEV_PORT.IN & UART_RXPIN) != 0) != high){
+            if(AUTOBAUD_TC.INTFLAGS & TC5_OVFIF_bm){
+                AUTOBAUD_TC.INTFLAGS = TC5_OVFIF_bm;
+                AB_ovf++;
+                if((uint16_t)(AB_ovf - start_ovf) > AUTOBAUD_TIMEOUT_OVF) return(false);
+            }
         }
         
-        // Calculate DMA's wridx
-        wridx = sizeof(RX_Buf) - trfcnt;
-        
-        // Discard data by moving rdidx
-        RX_rdidx = wridx;
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-            RX_laplead = 0;
+        cnt = AUTOBAUD_TC.CNT;
+        if((AUTOBAUD_TC.INTFLAGS & TC5_OVFIF_bm) && (cnt < 0x8000)){
+            // Counter overflowed after the loop last checked
+            AUTOBAUD_TC.INTFLAGS = TC5_OVFIF_bm;
+            AB_ovf++;
         }
-    #endif
-}
+        *timestamp = ((uint32_t)AB_ovf << 16) | cnt;
+        return(true);
+    }
+#endif
 
-//--------------------------------------------------------------------------------------------------
-char uart_getc(void){
-    #ifdef RXMODE_POLL
-        while(!(UART_DEV.STATUS & USART_RXCIF_bm));
-        return(UART_DEV.DATA);
-    #endif
-    
-    #ifdef RXMODE_INTR
-      char c;
-      while(fifo_rdcount(&RXFIFO) == 0);
-      fifo_read(&RXFIFO, &c, 1);
-      return(c);
-    #endif
-    
-    #ifdef RXMODE_DMA
-        char c;
-        
-        while(uart_rdcount() == 0);
+uint32_t uart_autobaud(void){
+    #ifdef AUTOBAUD
+        /* The sync character 0x55 is a string of alternating bits:
+         * 
+         *  idle |start| 1 | 0 | 1 | 0 | 1 | 0 | 1 | 0 |stop
+         *  -----+     +---+   +---+   +---+   +---+   +----
+         *       |_____|   |___|   |___|   |___|   |___|
+         *             t1      t3      t5      t7      t9
+         * 
+         * The rising edge at t1 is the first reference since the falling edge of the start bit may
+         * have been detected late. t9 - t1 spans 8 bits.
+         */
+        uint32_t t1, t;
+        uint32_t t3 = 0;
+        uint32_t total;
+        uint8_t i;
+        bool ok;
         
-        c = RX_Buf[RX_rdidx];
+        AUTOBAUD_TC.CTRLA = TC45_CLKSEL_OFF_gc;
+        AUTOBAUD_TC.CTRLB = 0;
+        AUTOBAUD_TC.PER = 0xFFFF;
+        AUTOBAUD_TC.CNT = 0;
+        AUTOBAUD_TC.INTFLAGS = TC5_OVFIF_bm;
+        AUTOBAUD_TC.CTRLA = TC45_CLKSEL_DIV1_gc;
         
-        if(RX_rdidx >= sizeof(RX_Buf)-1){
-            // rdidx wraps around
+        while(1){
+            // Wait for the line to be idle, then the start bit
+            ok = ab_wait_pin(true, &t) && ab_wait_pin(false, &t);
             
-            RX_rdidx = 0;
+            if(ok){
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                    AB_ovf = 0;
+                    ok = ab_wait_pin(true, &t1);
+                    for(i=0; ok && (i<4); i++){
+                        ok = ab_wait_pin(false, &t) && ab_wait_pin(true, &t);
+                        if(i == 0) t3 = t;
+                    }
+                }
+            }
             
-            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-                RX_laplead--;
+            if(!ok){
+                // Line is quiet, or stuck low
+                AUTOBAUD_TC.CTRLA = TC45_CLKSEL_OFF_gc;
+                return(0);
             }
             
-        }else{
-            // rdidx doesn't wrap
-            RX_rdidx++;
+            // Sanity check that the edges are evenly spaced. (Within 1/8th) If not, this wasn't
+            // the sync character. Wait for the next one.
+            total = t - t1;
+            t3 = (t3 - t1) * 4;
+            if((t3 > (total + total/8)) || (t3 < (total - total/8))) continue;
+            
+            break;
         }
         
-        return(c);
+        AUTOBAUD_TC.CTRLA = TC45_CLKSEL_OFF_gc;
+        
+        // Sync character was also received by the USART. Discard it.
+        uart_rdflush();
+        
+        return(uart_set_baud((F_CPU * 8 + total/2) / total));
+    #else
+        return(0);
     #endif
 }
 
-//--------------------------------------------------------------------------------------------------
-void uart_read(void *buf, size_t size){
-    #ifdef RXMODE_POLL
-        uint8_t* u8buf = (uint8_t*)buf;
-        while(size > 0){
-            while(!(UART_DEV.STATUS & USART_RXCIF_bm)); // wait until char received
-            if(u8buf){
-                *u8buf = UART_DEV.DATA;
-                u8buf++;
-            }else{
-                // discard
-                UART_DEV.STATUS = USART_RXCIF_bm;
+//==================================================================================================
+//                                          RX Functions
+//==================================================================================================
+#ifdef RXMODE_DMA
+    /**
+    * \brief Number of bytes the RX DMA has written into the block in progress
+    * \details A block that is complete but whose interrupt hasn't run yet counts as full.
+    **/
+    static uint16_t rx_dma_seg_written(void){
+        rx_cnt_t trfcnt;
+        
+        #if(RX_DMA_SEG_SIZE > 256)
+            // 16-bit registers are read through the EDMA TEMP register that all channels share. An
+            // ISR accessing another channel in between would corrupt the high byte.
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                trfcnt = EDMA.RX_DMA_CH.TRFCNT;
             }
-            size--;
+        #else
+            trfcnt = EDMA.RX_DMA_CH.TRFCNTL;
+        #endif
+        
+        // Checked after reading the count, so a block that completes in between is still caught
+        if(EDMA.RX_DMA_CH.CTRLB & EDMA_CH_TRNIF_bm){
+            return(RX_DMA_SEG_SIZE);
+        }
+        
+        // A 256-byte block that hasn't started reads as a count of 0. Cast wraps the offset to 0.
+        return((rx_cnt_t)(RX_DMA_SEG_SIZE - trfcnt));
+    }
+    
+    /**
+    * \brief Get a consistent snapshot of the RX DMA's position
+    * \param [out] laplead Value of RX_laplead that corresponds to the returned index
+    * \return Index in RX_Buf that the DMA will write next
+    **/
+    static rx_idx_t rx_dma_wridx(int8_t *laplead){
+        uint16_t offset;
+        uint8_t segidx = 0;
+        
+        // This CANNOT be done with interrupts disabled as it could skew the time that laplead gets
+        // incremented.
+        
+        if(RX_async_active){
+            // Channel belongs to uart_read_async(). Nothing to read from RX_Buf.
+            *laplead = 0;
+            return(RX_rdidx);
+        }
+        
+        #if(RX_DMA_SEGMENTS > 1)
+            do{
+                *laplead = RX_laplead;
+                segidx = RX_segidx;
+                offset = rx_dma_seg_written();
+            }while((*laplead != RX_laplead) || (segidx != RX_segidx)); // may be invalid. try again
+        #else
+            do{
+                *laplead = RX_laplead;
+                offset = rx_dma_seg_written();
+            }while(*laplead != RX_laplead); //if laplead changed, may be invalid. try again
+        #endif
+        
+        if(offset == RX_DMA_SEG_SIZE){
+            // Block is complete but its interrupt hasn't run yet. (Interrupts are masked, or a
+            // higher level ISR is running) Report the position that the interrupt will leave.
+            offset = 0;
+            segidx++;
+            if(segidx == RX_DMA_SEGMENTS){
+                segidx = 0;
+                (*laplead)++;
+            }
+        }
+        
+        return(segidx*RX_DMA_SEG_SIZE + offset);
+    }
+#endif
+
+#if defined(RX_EVENT) || (defined(RXMODE_DMA) && (defined(RX_FLOW_CTL) || defined(UART_STATS)))
+    /**
+    * \brief Number of bytes available. Unlike uart_rdcount(), this is safe to call from an ISR.
+    **/
+    static size_t rx_avail(void){
+        #ifdef RXMODE_INTR
+            return(fifo_rdcount(&RXFIFO));
+        #endif
+        
+        #ifdef RXMODE_DMA
+            int8_t laplead;
+            rx_idx_t wridx;
+            
+            wridx = rx_dma_wridx(&laplead);
+            if((laplead == 0) && (wridx >= RX_rdidx)){
+                return(wridx - RX_rdidx);
+            }else{
+                // Data wraps, or has overrun. Either way, it needs attention.
+                return(wridx + sizeof(RX_Buf) - RX_rdidx);
+            }
+        #endif
+    }
+#endif
+
+#ifdef RX_FLOW_CTL
+    /**
+    * \brief Update the RTS output based on the number of unread bytes
+    * \details RTS is driven high to request that the sender stops.
+    **/
+    static void rx_flow_update(size_t count){
+        if(count >= RX_FLOW_HIGH){
+            RX_FLOW_PORT.OUTSET = RXFC_PIN_bm;
+        }else if(count <= RX_FLOW_LOW){
+            RX_FLOW_PORT.OUTCLR = RXFC_PIN_bm;
+        }
+    }
+    
+    /**
+    * \brief Release RTS if the reader caught up. Call after reading data.
+    **/
+    static void rx_flow_release(void){
+        #ifdef RXMODE_INTR
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                rx_flow_update(fifo_rdcount(&RXFIFO));
+            }
+        #endif
+        
+        #ifdef RXMODE_DMA
+            // If the count is stale, the next DMA block interrupt re-asserts RTS.
+            if(rx_avail() <= RX_FLOW_LOW){
+                RX_FLOW_PORT.OUTCLR = RXFC_PIN_bm;
+            }
+        #endif
+    }
+#endif
+
+#if defined(UART_STATS) && !defined(RXMODE_DMA)
+    /**
+    * \brief Count a received character and its USART error flags
+    * \param status Value of the STATUS register read before DATA
+    **/
+    static void stats_rx_char(uint8_t status){
+        Stats.rx_bytes++;
+        if(status & USART_FERR_bm) Stats.frame_errors++;
+        if(status & USART_PERR_bm) Stats.parity_errors++;
+        if(status & USART_BUFOVF_bm) Stats.hw_overflows++;
+    }
+#endif
+
+#ifdef RXMODE_DMA
+    #ifdef RX_ASYNC_EVENT
+        static void rx_async_dispatch(void){
+            RX_async_pending = false;
+            RX_async_callback();
+        }
+    #endif
+    
+    /**
+    * \brief Resume receiving into RX_Buf after a uart_read_async() transfer and notify the caller
+    * \param defer Called from the interrupt. The callback goes through the event queue if enabled.
+    **/
+    static void rx_async_done(bool defer){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            rx_dma_ring_start();
+        }
+        
+        if(!RX_async_callback){
+            RX_async = false;
+            return;
+        }
+        
+        #ifdef RX_ASYNC_EVENT
+            if(defer){
+                RX_async_pending = true;
+                RX_async = false;
+                if(event_PushEvent(rx_async_dispatch, NULL, 0) == 0){
+                    return;
+                }
+                // Event queue is full. Calling it from here beats not calling it at all.
+                RX_async_pending = false;
+            }
+        #endif
+        
+        RX_async = false;
+        RX_async_callback();
+    }
+    
+    /**
+    * \brief Account for a completed block of the RX ring and clear its flags
+    * \details Called from the interrupt, or by uart_read_async() when it stops the ring with the
+    *   interrupt still pending.
+    **/
+    static void rx_dma_ring_advance(void){
+        #if(RX_DMA_SEGMENTS > 1)
+            // RX DMA has filled a block of RX_Buf
+            RX_segidx++;
+            if(RX_segidx == RX_DMA_SEGMENTS){
+                // RX DMA has wrapped around RX_Buf
+                RX_segidx = 0;
+                RX_laplead++;
+                EDMA.RX_DMA_CH.ADDRL = ((uintptr_t)(&RX_Buf)) & 0xFF;
+                EDMA.RX_DMA_CH.ADDRH = ((uintptr_t)(&RX_Buf)) >> 8;
+            }
+        #else
+            // RX DMA has wrapped around RX_Buf
+            RX_laplead++;
+        #endif
+        
+        // Clear flags
+        EDMA.RX_DMA_CH.CTRLB |= EDMA_CH_TRNIF_bm | EDMA_CH_ERRIF_bm;
+        
+        STATS_ADD(rx_bytes, RX_DMA_SEG_SIZE);
+    }
+    
+    ISR(RX_DMA_VECTOR){
+        if(RX_async_active){
+            // uart_read_async() transfer is complete
+            EDMA.RX_DMA_CH.CTRLB |= EDMA_CH_TRNIF_bm | EDMA_CH_ERRIF_bm;
+            RX_async_active = false;
+            
+            STATS_ADD(rx_bytes, RX_async_len);
+            
+            // If uart_read_async() is still copying from RX_Buf, it finishes up once it is done.
+            if(!RX_async_copy){
+                rx_async_done(true);
+            }
+            return;
+        }
+        
+        rx_dma_ring_advance();
+        
+        // Re-enable DMA manually because Atmel is a silly goose.
+        // Unless uart_read_async() is taking over the channel.
+        if(!RX_async){
+            EDMA.RX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
+        }
+        
+        #if defined(RX_FLOW_CTL) || defined(UART_STATS)
+            size_t avail = rx_avail();
+            STATS_PEAK(rx_peak, avail);
+            #ifdef RX_FLOW_CTL
+                rx_flow_update(avail);
+            #endif
+        #endif
+    }
+#endif
+
+#ifdef RX_EVENT
+    static void rx_event_post(void);
+#endif
+
+#ifdef UART_LINE
+    /**
+    * \brief Wrap an index that ran past the end of rxbuf
+    **/
+    static inline size_t rx_line_wrap(size_t idx){
+        if(idx >= sizeof(rxbuf)){
+            idx -= sizeof(rxbuf);
+        }
+        return(idx);
+    }
+    
+    /**
+    * \brief Check if a line of len characters fits after RXFIFO without reaching unread data
+    **/
+    static bool rx_line_fits(size_t len){
+        size_t start = RXFIFO.wridx;
+        size_t rdidx = RXFIFO.rdidx;
+        size_t room;
+        
+        // wridx must not become equal to rdidx once the line is added
+        if(rdidx > start){
+            room = rdidx - start - 1;
+        }else{
+            room = sizeof(rxbuf) - start + rdidx - 1;
+        }
+        return((RX_LINE_HDR + len) <= room);
+    }
+    
+    /**
+    * \brief Line discipline. Edit the current line with a received character
+    * \details Posts the RX event once a line is completed
+    **/
+    static void rx_line_char(uint8_t c){
+        size_t start = RXFIFO.wridx;
+        size_t len = RX_line_len;
+        
+        if((c == '\r') || (c == '\n')){
+            if((c == '\n') && RX_line_cr){
+                // LF of a CR+LF pair
+                RX_line_cr = false;
+                return;
+            }
+            RX_line_cr = (c == '\r');
+            
+            // A line with characters in it always has room for its length
+            if((len == 0) && !rx_line_fits(0)){
+                STATS_ADD(rx_overruns, 1);
+                STATS_ADD(rx_bytes_lost, 1);
+                return;
+            }
+            
+            rxbuf[start] = len & 0xFF;
+            rxbuf[rx_line_wrap(start + 1)] = len >> 8;
+            RXFIFO.wridx = RX_line_idx;
+            RX_line_idx = rx_line_wrap(RX_line_idx + RX_LINE_HDR);
+            RX_line_len = 0;
+            
+            #ifdef RX_EVENT
+                if(RX_event.handler){
+                    rx_event_post();
+                }
+            #endif
+            return;
+        }
+        
+        RX_line_cr = false;
+        
+        if((c == '\b') || (c == 0x7F)){
+            if(len != 0){
+                RX_line_len = len - 1;
+                RX_line_idx = (RX_line_idx == 0) ? (sizeof(rxbuf) - 1) : (RX_line_idx - 1);
+            }
+            return;
+        }
+        
+        if(!rx_line_fits(len + 1)){
+            // No room. Drop the character.
+            STATS_ADD(rx_overruns, 1);
+            STATS_ADD(rx_bytes_lost, 1);
+            return;
+        }
+        
+        rxbuf[RX_line_idx] = c;
+        RX_line_idx = rx_line_wrap(RX_line_idx + 1);
+        RX_line_len = len + 1;
+    }
+#endif
+
+#ifdef RXMODE_INTR
+    // Only this ISR writes to RXFIFO, so the inline fifo_isr_* accessors can be used.
+    ISR(RX_ISR_VECTOR){
+        uint8_t c;
+        #if defined(UART_STATS) || defined(MPCM)
+            uint8_t status;
+        #endif
+        #ifdef UART_STATS
+            size_t count;
+        #endif
+        
+        #if defined(UART_STATS) || defined(MPCM)
+            // Flags belong to the character in DATA. Read them first.
+            status = UART_DEV.STATUS;
+        #endif
+        c = UART_DEV.DATA;
+        
+        #ifdef RS485
+            // Our own transmission
+            if(DE_asserted) return;
+        #endif
+        
+        STATS_RX_CHAR(status);
+        
+        #ifdef MPCM
+            if(status & USART_RXB8_bm){
+                // Address frame. Only receive the data frames that follow if they are for this node.
+                if((MPCM_address < 0) || (c == MPCM_address) || (c == UART_MPCM_BROADCAST)){
+                    UART_DEV.CTRLB &= ~USART_MPCM_bm;
+                }else{
+                    UART_DEV.CTRLB |= USART_MPCM_bm;
+                }
+                return;
+            }
+        #endif
+        
+        #ifdef UART_LINE
+            rx_line_char(c);
+            #ifdef UART_STATS
+                count = fifo_isr_rdcount(&RXFIFO);
+                STATS_PEAK(rx_peak, count);
+            #endif
+        #elif defined(UART_STATS)
+            if(fifo_isr_putc(&RXFIFO, c) != 0){
+                Stats.rx_overruns++;
+                Stats.rx_bytes_lost++;
+            }
+            count = fifo_isr_rdcount(&RXFIFO);
+            STATS_PEAK(rx_peak, count);
+        #else
+            fifo_isr_putc(&RXFIFO, c);
+        #endif
+        
+        #ifdef RX_FLOW_CTL
+            rx_flow_update(fifo_isr_rdcount(&RXFIFO));
+        #endif
+        
+        #ifdef RX_EVENT
+            if(RX_event.handler){
+                RX_event_active = true;
+                #ifndef UART_LINE
+                    if(((int16_t)c == RX_event.delimiter)
+                        || (RX_event.threshold && (fifo_isr_rdcount(&RXFIFO) >= RX_event.threshold))){
+                        rx_event_post();
+                    }
+                #endif
+            }
+        #endif
+    }
+#endif
+
+//--------------------------------------------------------------------------------------------------
+size_t uart_rdcount(void){
+    #ifdef RXMODE_POLL
+        if(UART_DEV.STATUS & USART_RXCIF_bm){
+            return(1);
+        }else{
+            return(0);
+        }
+    #endif
+    
+    #ifdef RXMODE_INTR
+        return(fifo_rdcount(&RXFIFO));
+    #endif
+    
+    #ifdef RXMODE_DMA
+        int8_t laplead;
+        rx_idx_t wridx;
+        size_t count;
+        
+        // get snapshot of DMA buffer status
+        wridx = rx_dma_wridx(&laplead);
+        
+        if((laplead == 0) && (wridx >= RX_rdidx)){
+            // Data doesn't wrap
+            count = wridx - RX_rdidx;
+            STATS_PEAK(rx_peak, count);
+            return(count);
+        
+        }else if(((laplead == 1) && (wridx <= RX_rdidx)) || ((laplead == 0) && (wridx < RX_rdidx))){
+            // Available data wraps.
+            count = wridx + sizeof(RX_Buf) - RX_rdidx;
+            STATS_PEAK(rx_peak, count);
+            return(count);
+        }else{
+            // Overrun!
+            
+            #ifdef UART_STATS
+                // Everything that was unread is discarded
+                Stats.rx_overruns++;
+                Stats.rx_bytes_lost += (size_t)laplead*sizeof(RX_Buf) + wridx - RX_rdidx;
+            #endif
+            
+            // Move read pointer to a safe position
+            RX_rdidx = wridx;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                RX_laplead -= laplead;
+            }
+            
+            #ifdef RX_FLOW_CTL
+                rx_flow_release();
+            #endif
+            
+            return(0);
+        }
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+void uart_rdflush(void){
+    #ifdef RXMODE_POLL
+        // Clear flag
+        UART_DEV.STATUS = USART_RXCIF_bm;
+    #endif
+    
+    #ifdef RXMODE_INTR
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            fifo_clear(&RXFIFO);
+            #ifdef UART_LINE
+                RX_line_idx = RX_LINE_HDR;
+                RX_line_len = 0;
+                RX_line_cr = false;
+            #endif
+        }
+    #endif
+    
+    #ifdef RXMODE_DMA
+        int8_t laplead;
+        rx_idx_t wridx;
+        
+        // Calculate DMA's wridx
+        wridx = rx_dma_wridx(&laplead);
+        
+        // Discard data by moving rdidx. The snapshot's laps are subtracted rather than clearing
+        // RX_laplead, in case a block interrupt is still pending.
+        RX_rdidx = wridx;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            RX_laplead -= laplead;
+        }
+    #endif
+    
+    #ifdef RX_FLOW_CTL
+        rx_flow_release();
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+char uart_getc(void){
+    #ifdef RXMODE_POLL
+        while(!(UART_DEV.STATUS & USART_RXCIF_bm));
+        STATS_RX_CHAR(UART_DEV.STATUS);
+        return(UART_DEV.DATA);
+    #endif
+    
+    #ifdef RXMODE_INTR
+      char c;
+      while(fifo_rdcount(&RXFIFO) == 0);
+      fifo_read(&RXFIFO, &c, 1);
+      #ifdef RX_FLOW_CTL
+          rx_flow_release();
+      #endif
+      return(c);
+    #endif
+    
+    #ifdef RXMODE_DMA
+        char c;
+        
+        while(uart_rdcount() == 0);
+        
+        c = RX_Buf[RX_rdidx];
+        
+        if(RX_rdidx >= sizeof(RX_Buf)-1){
+            // rdidx wraps around
+            
+            RX_rdidx = 0;
+            
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                RX_laplead--;
+            }
+            
+        }else{
+            // rdidx doesn't wrap
+            RX_rdidx++;
+        }
+        
+        #ifdef RX_FLOW_CTL
+            rx_flow_release();
+        #endif
+        
+        return(c);
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+void uart_read(void *buf, size_t size){
+    #ifdef RXMODE_POLL
+        uint8_t* u8buf = (uint8_t*)buf;
+        while(size > 0){
+            while(!(UART_DEV.STATUS & USART_RXCIF_bm)); // wait until char received
+            STATS_RX_CHAR(UART_DEV.STATUS);
+            if(u8buf){
+                *u8buf = UART_DEV.DATA;
+                u8buf++;
+            }else{
+                // discard
+                UART_DEV.STATUS = USART_RXCIF_bm;
+            }
+            size--;
         }
     #endif
     
@@ -430,28 +1276,23 @@ void uart_read(void *buf, size_t size){
                     fifo_read(&RXFIFO, NULL, rdcount);
                 }
                 size -= rdcount;
+                
+                #ifdef RX_FLOW_CTL
+                    rx_flow_release();
+                #endif
             }
         }
     #endif
     
     #ifdef RXMODE_DMA
-        uint8_t trfcnt;
         int8_t laplead;
-        uint8_t wridx;
+        rx_idx_t wridx;
         uint8_t* u8buf = (uint8_t*)buf;
         uint16_t rdcount;
         
         while(size > 0){
             // get snapshot of DMA buffer status
-            // This CANNOT be done with interrupts disabled as it could skew the time that laplead gets
-            // incremented.
-            do{
-                laplead = RX_laplead;
-                trfcnt = EDMA.RX_DMA_CH.TRFCNTL;
-            }while(laplead != RX_laplead); //if laplead changed, may be invalid. try again
-            
-            // Calculate DMA's wridx
-            wridx = sizeof(RX_Buf) - trfcnt;
+            wridx = rx_dma_wridx(&laplead);
             
             if((laplead == 0) && (wridx >= RX_rdidx)){
                 // Data doesn't wrap
@@ -461,9 +1302,10 @@ void uart_read(void *buf, size_t size){
                 }
                 
                 // copy rdcount into u8buf
-                memcpy(u8buf, &rxbuf[RX_rdidx], rdcount);
-                
-                u8buf += rdcount;
+                if(u8buf){
+                    memcpy(u8buf, &RX_Buf[RX_rdidx], rdcount);
+                    u8buf += rdcount;
+                }
                 size -= rdcount;
                 RX_rdidx += rdcount;
                 
@@ -471,38 +1313,340 @@ void uart_read(void *buf, size_t size){
                 // Available data wraps.
                 
                 // number of bytes to the end of the buffer
-                rdcount = sizeof(rxbuf) - RX_rdidx;
+                rdcount = sizeof(RX_Buf) - RX_rdidx;
                 if(rdcount > size){
                     rdcount = size;
                 }
                 
                 // copy rdcount into u8buf
-                memcpy(u8buf, &rxbuf[RX_rdidx], rdcount);
-                
-                u8buf += rdcount;
+                if(u8buf){
+                    memcpy(u8buf, &RX_Buf[RX_rdidx], rdcount);
+                    u8buf += rdcount;
+                }
                 size -= rdcount;
-                RX_rdidx += rdcount;
                 
-                if(RX_rdidx == sizeof(rxbuf)){
+                if(RX_rdidx + rdcount == sizeof(RX_Buf)){
                     // read to the end. Wrap back
                     RX_rdidx = 0;
                     ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
                         RX_laplead--;
                     }
+                }else{
+                    RX_rdidx += rdcount;
+                }
+            }else{
+                // Overrun!
+                
+                #ifdef UART_STATS
+                    // Everything that was unread is discarded
+                    Stats.rx_overruns++;
+                    Stats.rx_bytes_lost += (size_t)laplead*sizeof(RX_Buf) + wridx - RX_rdidx;
+                #endif
+                
+                // Move read pointer to a safe position
+                RX_rdidx = wridx;
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                    RX_laplead -= laplead;
+                }
+                
+                #ifdef RX_FLOW_CTL
+                    rx_flow_release();
+                #endif
+                
+                // Abort reading.
+                return;
+            }
+            
+            #ifdef RX_FLOW_CTL
+                rx_flow_release();
+            #endif
+        }
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+bool uart_read_async(void *buf, size_t size, void (*callback)(void)){
+    #ifdef RXMODE_DMA
+        size_t count;
+        size_t len;
+        rx_idx_t rdidx;
+        bool done;
+        
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            if(RX_async || RX_async_pending){
+                // Previous transfer or its callback hasn't finished yet
+                return(false);
+            }
+            
+            // Stop the ring. ENABLE clears once the current single-byte burst is done, which
+            // doesn't depend on any interrupt.
+            RX_async = true;
+            EDMA.RX_DMA_CH.CTRLA &= ~EDMA_CH_ENABLE_bm;
+            while(EDMA.RX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm);
+            
+            // A block that just completed still has its interrupt pending. It can't run here, and
+            // may never run if this was called with interrupts masked. Do its work instead.
+            if(EDMA.RX_DMA_CH.CTRLB & EDMA_CH_TRNIF_bm){
+                rx_dma_ring_advance();
+            }
+        }
+        
+        count = uart_rdcount();
+        if(count >= size){
+            // Everything is already in RX_Buf. Resume the ring and read it normally.
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                RX_async = false;
+                EDMA.RX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
+            }
+            uart_read(buf, size);
+            if(callback){
+                callback();
+            }
+            return(true);
+        }
+        
+        // Hand the channel over to a one-shot transfer into the rest of buf before copying
+        // anything. Otherwise nothing drains the USART while RX_Buf is copied.
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            uintptr_t addr = (uintptr_t)buf + count;
+            
+            len = size - count;
+            RX_async_callback = callback;
+            RX_async_len = len;
+            RX_async_copy = true;
+            RX_async_active = true;
+            
+            EDMA.RX_DMA_CH.ADDRCTRL = EDMA_CH_RELOAD_NONE_gc | EDMA_CH_DIR_INC_gc;
+            EDMA.RX_DMA_CH.TRFCNTL = (len & 0xFF);
+            EDMA.RX_DMA_CH.TRFCNTH = (len >> 8);
+            EDMA.RX_DMA_CH.ADDRL = addr & 0xFF;
+            EDMA.RX_DMA_CH.ADDRH = addr >> 8;
+            EDMA.RX_DMA_CH.CTRLA |= EDMA_CH_ENABLE_bm;
+        }
+        
+        #ifdef RX_FLOW_CTL
+            // Nothing can overrun while the DMA writes into buf
+            RX_FLOW_PORT.OUTCLR = RXFC_PIN_bm;
+        #endif
+        
+        // RX_Buf is frozen now. Its unread data goes in front of what the DMA receives.
+        // RX_rdidx doesn't need updating since the ring restarts from the beginning afterwards.
+        rdidx = RX_rdidx;
+        len = sizeof(RX_Buf) - rdidx;
+        if(len > count){
+            len = count;
+        }
+        memcpy(buf, &RX_Buf[rdidx], len);
+        memcpy((uint8_t*)buf + len, RX_Buf, count - len);
+        
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            RX_async_copy = false;
+            done = !RX_async_active;
+        }
+        if(done){
+            // Transfer completed during the copy. The interrupt left the rest to this function.
+            rx_async_done(false);
+        }
+        return(true);
+    #else
+        uart_read(buf, size);
+        if(callback){
+            callback();
+        }
+        return(true);
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+bool uart_read_async_busy(void){
+    #ifdef RXMODE_DMA
+        return(RX_async || RX_async_pending);
+    #else
+        return(false);
+    #endif
+}
+
+//==================================================================================================
+//                                          Line Discipline
+//==================================================================================================
+bool uart_line_get(char *buf, size_t size, size_t *len){
+    #ifdef UART_LINE
+        size_t rdidx;
+        size_t wridx;
+        size_t linelen;
+        size_t n;
+        size_t first;
+        
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            rdidx = RXFIFO.rdidx;
+            wridx = RXFIFO.wridx;
+        }
+        
+        if(rdidx == wridx){
+            return(false);
+        }
+        
+        linelen = rxbuf[rdidx] | ((size_t)rxbuf[rx_line_wrap(rdidx + 1)] << 8);
+        rdidx = rx_line_wrap(rdidx + RX_LINE_HDR);
+        
+        // Copy what fits. The line may wrap around the end of rxbuf.
+        n = linelen;
+        if(n >= size){
+            n = size - 1;
+        }
+        first = sizeof(rxbuf) - rdidx;
+        if(first > n){
+            first = n;
+        }
+        memcpy(buf, &rxbuf[rdidx], first);
+        memcpy(buf + first, rxbuf, n - first);
+        buf[n] = 0;
+        *len = n;
+        
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            RXFIFO.rdidx = rx_line_wrap(rdidx + linelen);
+        }
+        
+        #ifdef RX_FLOW_CTL
+            rx_flow_release();
+        #endif
+        
+        return(true);
+    #else
+        return(false);
+    #endif
+}
+
+//==================================================================================================
+//                                      RX Event Notifications
+//==================================================================================================
+#ifdef RX_EVENT
+    static void rx_event_dispatch(void){
+        RX_event_pending = false;
+        if(RX_event.handler){
+            RX_event.handler();
+        }
+    }
+    
+    /**
+    * \brief Push the RX event into the event queue unless it is already pending
+    **/
+    static void rx_event_post(void){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            if(!RX_event_pending){
+                if(event_PushEvent(rx_event_dispatch, NULL, 0) == 0){
+                    RX_event_pending = true;
+                }
+            }
+        }
+    }
+    
+    //----------------------------------------------------------------------------------------------
+    static void rx_event_tick(void *data){
+        if(RX_event.handler == NULL) return;
+        
+        #ifdef RXMODE_DMA
+            // No per-byte interrupt in DMA mode. Check what arrived since the last tick.
+            int8_t laplead;
+            rx_idx_t wridx;
+            bool post = false;
+            
+            wridx = rx_dma_wridx(&laplead);
+            if(wridx != RX_event_scanidx){
+                RX_event_active = true;
+                
+                if(RX_event.delimiter >= 0){
+                    while(RX_event_scanidx != wridx){
+                        if(RX_Buf[RX_event_scanidx] == (uint8_t)RX_event.delimiter){
+                            post = true;
+                        }
+                        RX_event_scanidx++;
+                        if(RX_event_scanidx >= sizeof(RX_Buf)){
+                            RX_event_scanidx = 0;
+                        }
+                    }
+                }else{
+                    RX_event_scanidx = wridx;
                 }
-            }else{
-                // Overrun!
                 
-                // Move read pointer to a safe position
-                RX_rdidx = wridx;
-                ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-                    RX_laplead -= laplead;
+                if(RX_event.threshold && (rx_avail() >= RX_event.threshold)){
+                    post = true;
+                }
+            }
+            
+            if(post){
+                rx_event_post();
+            }
+        #endif
+        
+        if(RX_event_active){
+            RX_event_active = false;
+            RX_event_idle_armed = true;
+            RX_event_quiet = 0;
+        }else if(RX_event_idle_armed && RX_event.idle_ticks){
+            RX_event_quiet += RX_event_interval;
+            if(RX_event_quiet >= RX_event.idle_ticks){
+                // Line went idle
+                RX_event_idle_armed = false;
+                if(rx_avail() != 0){
+                    rx_event_post();
                 }
-                
-                // Abort reading.
-                return;
             }
         }
+    }
+#endif
+
+//--------------------------------------------------------------------------------------------------
+void uart_rx_event_start(const struct uart_rx_eventctl *settings){
+    #ifdef RX_EVENT
+        struct timerctl tctl;
+        
+        uart_rx_event_stop();
+        
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            RX_event = *settings;
+            RX_event_active = false;
+            RX_event_idle_armed = true;
+            RX_event_quiet = 0;
+            #ifdef RXMODE_DMA
+                RX_event_scanidx = RX_rdidx;
+            #endif
+        }
+        
+        #ifdef RXMODE_DMA
+            // Delimiter and threshold are checked on every tick, however long idle_ticks is
+            tctl.interval = RX_EVENT_DMA_POLL_TICKS;
+        #else
+            tctl.interval = settings->idle_ticks;
+        #endif
+        RX_event_interval = tctl.interval;
+        
+        if(tctl.interval){
+            tctl.repeat = true;
+            tctl.callback = rx_event_tick;
+            tctl.callback_data = NULL;
+            timer_start(&RX_event_timer, &tctl);
+            RX_event_timer_running = true;
+        }
+        
+        // Data may already be waiting
+        if(settings->threshold && (rx_avail() >= settings->threshold)){
+            rx_event_post();
+        }
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+void uart_rx_event_stop(void){
+    #ifdef RX_EVENT
+        if(RX_event_timer_running){
+            timer_stop(&RX_event_timer);
+            RX_event_timer_running = false;
+        }
+        
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            RX_event.handler = NULL;
+        }
     #endif
 }
 
@@ -510,6 +1654,36 @@ void uart_read(void *buf, size_t size){
 //                                          TX Functions
 //==================================================================================================
 
+#ifdef RS485
+    /**
+    * \brief Take the bus before transmitting
+    * \details Asserts DE. Characters received while DE is asserted are our own and are discarded.
+    *   In RX DMA mode, the RX DMA trigger is turned off and the RX interrupt discards them instead.
+    *   DE is released in the TXC interrupt once the last character has been shifted out.
+    **/
+    static void rs485_begin(void){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            if(!DE_asserted){
+                DE_asserted = true;
+                #ifdef RXMODE_DMA
+                    EDMA.RX_DMA_CH.TRIGSRC = EDMA_CH_TRIGSRC_OFF_gc;
+                    UART_DEV.CTRLA = (UART_DEV.CTRLA & ~USART_RXCINTLVL_gm) | RX_ISR_INTLVL;
+                #endif
+                RS485_DE_PORT.OUTSET = DE_PIN_bm;
+                
+                // Discard a stale TXC flag from a previous transmission
+                UART_DEV.STATUS = USART_TXCIF_bm;
+                UART_DEV.CTRLA = (UART_DEV.CTRLA & ~USART_TXCINTLVL_gm) | TXC_ISR_INTLVL;
+                
+                #ifdef UART_STATS
+                    Stats.de_asserts++;
+                    Stats_de_start = UART_STATS_TICKS();
+                #endif
+            }
+        }
+    }
+#endif
+
 #ifdef TXMODE_DMA
     static void tx_dma_start(void){
         
@@ -533,7 +1707,21 @@ void uart_read(void *buf, size_t size){
         
         // If data is to be sent, start a transfer
         if(TX_transfer_len != 0){
-            EDMA.TX_DMA_CH.TRFCNTL = TX_transfer_len;
+            #ifdef RS485
+                rs485_begin();
+            #else
+                // TXCIF is set again once the last character of this transfer is shifted out
+                UART_DEV.STATUS = USART_TXCIF_bm;
+                TX_txc_wait = true;
+            #endif
+            #ifdef TX_DMA_WIDE
+                // Written through the shared EDMA TEMP register. Must not be interrupted.
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                    EDMA.TX_DMA_CH.TRFCNT = TX_transfer_len;
+                }
+            #else
+                EDMA.TX_DMA_CH.TRFCNTL = TX_transfer_len;
+            #endif
             EDMA.TX_DMA_CH.ADDRL = ((uintptr_t)(&TX_Buf[TX_transfer_idx])) & 0xFF;
             EDMA.TX_DMA_CH.ADDRH = ((uintptr_t)(&TX_Buf[TX_transfer_idx])) >> 8;
             
@@ -543,24 +1731,64 @@ void uart_read(void *buf, size_t size){
     }
     
     ISR(TX_DMA_VECTOR){
+        // Send everything that accumulated during the previous transfer
         tx_dma_start();
     }
+    
+    #ifdef TX_COALESCE
+        /**
+        * \brief Number of bytes in TX_Buf that are not part of a DMA transfer yet
+        **/
+        static size_t tx_dma_held(void){
+            size_t idx;
+            
+            idx = TX_transfer_idx + TX_transfer_len;
+            if(idx >= sizeof(TX_Buf)){
+                idx = 0;
+            }
+            
+            if(TX_wridx >= idx){
+                return(TX_wridx - idx);
+            }else{
+                return(TX_wridx + sizeof(TX_Buf) - idx);
+            }
+        }
+        
+        /**
+        * \brief Coalescing timeout expired. Send whatever is held.
+        **/
+        static void tx_coalesce_timeout(void *data){
+            TX_coalesce_timer_running = false;
+            
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                if(!(EDMA.TX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm)){
+                    tx_dma_start();
+                }
+            }
+        }
+    #endif
 #endif
 
 #ifdef TXMODE_INTR
+    // Only this ISR reads from TXFIFO, so the inline fifo_isr_* accessors can be used.
     ISR(TX_ISR_VECTOR){
         uint8_t c;
         #ifdef TX_FLOW_CTL
             if(TX_FLOW_PORT.IN & TXFC_PIN_bm){
                 // CTS is high, requesting TX stop.
                 
+                #ifdef UART_STATS
+                    Stats.cts_stalls++;
+                    Stats_cts_start = UART_STATS_TICKS();
+                #endif
+                
                 // disable tx interrupt
                 UART_DEV.CTRLA &= ~(USART_DREINTLVL_gm);
                 
                 // Enable pin interrupt when CTS = 0
                 TX_FLOW_PORT.TXFC_INTMASK = TXFC_PIN_bm;
             }else{
-                if(fifo_read(&TXFIFO, &c, 1) == 0){
+                if(fifo_isr_getc(&TXFIFO, &c) == 0){
                     UART_DEV.DATA = c;
                 }else{
                     // disable tx interrupt
@@ -568,7 +1796,7 @@ void uart_read(void *buf, size_t size){
                 }
             }
         #else
-            if(fifo_read(&TXFIFO, &c, 1) == 0){
+            if(fifo_isr_getc(&TXFIFO, &c) == 0){
                 UART_DEV.DATA = c;
             }else{
                 // disable tx interrupt
@@ -578,22 +1806,96 @@ void uart_read(void *buf, size_t size){
     }
 #endif
 
+#ifdef RS485
+    ISR(TXC_ISR_VECTOR){
+        // Shift register and DATA are empty. Keep the bus if more data is about to follow.
+        #ifdef TXMODE_INTR
+            if(fifo_isr_rdcount(&TXFIFO) != 0) return;
+        #endif
+        #ifdef TXMODE_DMA
+            if((EDMA.TX_DMA_CH.CTRLB & EDMA_CH_TRNINTLVL_gm) == 0){
+                // uart_tx_commit() is adding data. It starts a transfer once it is done.
+                return;
+            }
+            if(EDMA.TX_DMA_CH.CTRLB & EDMA_CH_TRNIF_bm){
+                // Transfer complete interrupt hasn't run yet. Start what is queued from here.
+                tx_dma_start();
+            }
+            if(EDMA.TX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm) return;
+        #endif
+        
+        RS485_DE_PORT.OUTCLR = DE_PIN_bm;
+        DE_asserted = false;
+        UART_DEV.CTRLA &= ~USART_TXCINTLVL_gm;
+        
+        // Discard the echo of the last character if the RX interrupt hasn't taken it yet
+        while(UART_DEV.STATUS & USART_RXCIF_bm){
+            (void)UART_DEV.DATA;
+        }
+        #ifdef RXMODE_DMA
+            UART_DEV.CTRLA &= ~USART_RXCINTLVL_gm;
+            EDMA.RX_DMA_CH.TRIGSRC = RX_DMA_TRIGSRC;
+        #endif
+        
+        #ifdef UART_STATS
+            Stats.de_ticks += (uint16_t)(UART_STATS_TICKS() - Stats_de_start);
+        #endif
+    }
+    
+    #ifdef RXMODE_DMA
+        // RX DMA is paused while DE is asserted. Discard our own transmission.
+        ISR(RX_ISR_VECTOR){
+            (void)UART_DEV.DATA;
+        }
+    #endif
+#endif
+
+#ifdef TXMODE_INTR
+    /**
+    * \brief Enable the TX interrupt after data was added to TXFIFO
+    **/
+    static void tx_intr_start(void){
+        #ifdef RS485
+            rs485_begin();
+        #endif
+        
+        #ifdef TX_FLOW_CTL
+            // If not transmitting already, enable TX Interrupt
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                if((TX_FLOW_PORT.TXFC_INTMASK & TXFC_PIN_bm) == 0) {
+                    // Pin interrupt isn't already enabled. Safe to enable TX interrupt
+                    UART_DEV.CTRLA |= TX_ISR_INTLVL;
+                }
+            }
+        
+        #else
+            // Enable TX interrupt.
+            // If TX is idle, then the interrupt should occur immediately.
+            UART_DEV.CTRLA |= TX_ISR_INTLVL;
+        #endif
+    }
+#endif
+
 #ifdef TX_FLOW_CTL
     ISR(TX_FLOW_PIN_VECTOR){
         TX_FLOW_PORT.TXFC_INTMASK = 0x00;
         TX_FLOW_PORT.INTFLAGS = TXFC_INTIF_bm; // Clear flag
         UART_DEV.CTRLA |= TX_ISR_INTLVL; // Enable TX interrupt
+        #ifdef UART_STATS
+            Stats.cts_blocked_ticks += (uint16_t)(UART_STATS_TICKS() - Stats_cts_start);
+        #endif
     }
 #endif
 
 //--------------------------------------------------------------------------------------------------
 void uart_write(void *buf, size_t size){
     #ifdef TXMODE_POLL
-        while(len){
+        uint8_t* u8buf = (uint8_t*)buf;
+        while(size){
             // while outgoing data exists
-            uart_putc((const char)*data);
-            data++;
-            len--;
+            uart_putc((const char)*u8buf);
+            u8buf++;
+            size--;
         }
     #endif
     
@@ -601,6 +1903,7 @@ void uart_write(void *buf, size_t size){
         size_t wrcount;
         uint8_t* u8buf = (uint8_t*)buf;
         
+        STATS_ADD(tx_bytes, size);
         while(size > 0){
             // Get number of bytes that can be written.
             wrcount = fifo_wrcount(&TXFIFO);
@@ -612,53 +1915,27 @@ void uart_write(void *buf, size_t size){
                 fifo_write(&TXFIFO, u8buf, wrcount);
                 u8buf += wrcount;
                 size -= wrcount;
-                // Enable TX Channel
-                #ifdef TX_FLOW_CTL
-                    // If not transmitting already, enable TX Interrupt
-                    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-                        if((TX_FLOW_PORT.TXFC_INTMASK & TXFC_PIN_bm) == 0) {
-                            // Pin interrupt isn't already enabled. Safe to enable TX interrupt
-                            UART_DEV.CTRLA |= TX_ISR_INTLVL;
-                        }
-                    }
-                    
-                #else
-                    // Enable TX interrupt.
-                    // If TX is idle, then the interrupt should occur immediately.
-                    UART_DEV.CTRLA |= TX_ISR_INTLVL;
+                #ifdef UART_STATS
+                    wrcount = fifo_rdcount(&TXFIFO);
+                    STATS_PEAK(tx_peak, wrcount);
                 #endif
+                tx_intr_start();
             }
         }
     #endif
     
     #ifdef TXMODE_DMA
         uint8_t* u8buf = (uint8_t*)buf;
-        while(len){
+        char *span;
+        size_t wrcount;
+        
+        while(size){
             // while outgoing data exists
-            
-            // Disable the DMA interrupt so it doesn't start a new transfer before loading is complete
-            EDMA.TX_DMA_CH.CTRLB = 0;
-            
-            if((TX_wridx != TX_transfer_idx-1) && !((TX_wridx == sizeof(TX_Buf)-1) && (TX_transfer_idx == 0))){
-                // Buffer has room. Copy data
-                
-                TX_Buf[TX_wridx] = *u8buf;
-                u8buf++;
-                len--;
-                if(TX_wridx == sizeof(TX_Buf)-1){
-                    TX_wridx = 0;
-                }else{
-                    TX_wridx++;
-                }
-            }
-            
-            
-            // If DMA isn't running, start it
-            if (!(EDMA.TX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm)){
-                tx_dma_start();
-            }
-            
-            EDMA.TX_DMA_CH.CTRLB = TX_DMA_INTLVL;
+            wrcount = uart_tx_reserve(&span, size);
+            memcpy(span, u8buf, wrcount);
+            uart_tx_commit(wrcount);
+            u8buf += wrcount;
+            size -= wrcount;
         }
     #endif
 }
@@ -668,6 +1945,7 @@ void uart_putc(const char c){
     #ifdef TXMODE_POLL
         while(!(UART_DEV.STATUS & USART_DREIF_bm));
         UART_DEV.DATA = c;
+        STATS_ADD(tx_bytes, 1);
     #endif
     
     #ifdef TXMODE_INTR
@@ -696,3 +1974,253 @@ void uart_puts(const char *s){
         uart_write((uint8_t*)s, strlen(s));
     #endif
 }
+
+//--------------------------------------------------------------------------------------------------
+size_t uart_tx_reserve(char **ptr, size_t max){
+    size_t len;
+    
+    #ifdef TXMODE_POLL
+        *ptr = TX_stage;
+        len = sizeof(TX_stage);
+    #endif
+    
+    #ifdef TXMODE_INTR
+        uint8_t *span;
+        
+        // Wait for room
+        while((len = fifo_wrspan(&TXFIFO, &span)) == 0);
+        *ptr = (char*)span;
+    #endif
+    
+    #ifdef TXMODE_DMA
+        tx_idx_t transfer_idx;
+        
+        // Wait for room. Free space ends one byte before the start of the current DMA transfer.
+        do{
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                transfer_idx = TX_transfer_idx;
+            }
+            
+            if(transfer_idx > TX_wridx){
+                len = transfer_idx - TX_wridx - 1;
+            }else if(transfer_idx == 0){
+                len = sizeof(TX_Buf) - TX_wridx - 1;
+            }else{
+                len = sizeof(TX_Buf) - TX_wridx;
+            }
+        }while(len == 0);
+        *ptr = (char*)&TX_Buf[TX_wridx];
+    #endif
+    
+    if(len > max){
+        len = max;
+    }
+    return(len);
+}
+
+//--------------------------------------------------------------------------------------------------
+void uart_tx_commit(size_t len){
+    if(len == 0) return;
+    
+    STATS_ADD(tx_bytes, len);
+    
+    #ifdef TXMODE_POLL
+        uint8_t i;
+        for(i=0; i<len; i++){
+            while(!(UART_DEV.STATUS & USART_DREIF_bm));
+            UART_DEV.DATA = TX_stage[i];
+        }
+    #endif
+    
+    #ifdef TXMODE_INTR
+        fifo_wrcommit(&TXFIFO, len);
+        #ifdef UART_STATS
+            len = fifo_rdcount(&TXFIFO);
+            STATS_PEAK(tx_peak, len);
+        #endif
+        tx_intr_start();
+    #endif
+    
+    #ifdef TXMODE_DMA
+        // Disable the DMA interrupt so it doesn't start a new transfer before loading is complete
+        EDMA.TX_DMA_CH.CTRLB = 0;
+        
+        len += TX_wridx;
+        if(len >= sizeof(TX_Buf)){
+            len = 0;
+        }
+        TX_wridx = len;
+        
+        #ifdef UART_STATS
+            // Bytes waiting in TX_Buf, including the transfer in progress
+            if(TX_wridx >= TX_transfer_idx){
+                len = TX_wridx - TX_transfer_idx;
+            }else{
+                len = TX_wridx + sizeof(TX_Buf) - TX_transfer_idx;
+            }
+            STATS_PEAK(tx_peak, len);
+        #endif
+        
+        #ifdef TX_COALESCE
+            bool start_timer = false;
+            
+            // If DMA isn't running, start it once enough data is held. Otherwise wait for the
+            // timeout. If DMA is running, the held data is sent when the current transfer completes.
+            // The timeout may also start the DMA, so this must be atomic.
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                if (!(EDMA.TX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm)){
+                    if(tx_dma_held() >= TX_COALESCE_THRESHOLD){
+                        tx_dma_start();
+                    }else if(!TX_coalesce_timer_running){
+                        TX_coalesce_timer_running = true;
+                        start_timer = true;
+                    }
+                }
+                
+                EDMA.TX_DMA_CH.CTRLB = TX_DMA_INTLVL;
+            }
+            
+            if(start_timer){
+                // This may be in an ISR. timer_start() is interrupt safe, and the flag above keeps
+                // another caller from starting the timer twice.
+                struct timerctl tctl;
+                tctl.interval = TX_COALESCE_TICKS;
+                tctl.repeat = false;
+                tctl.callback = tx_coalesce_timeout;
+                tctl.callback_data = NULL;
+                timer_start(&TX_coalesce_timer, &tctl);
+            }
+        #else
+            // If DMA isn't running, start it
+            if (!(EDMA.TX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm)){
+                tx_dma_start();
+            }
+            
+            EDMA.TX_DMA_CH.CTRLB = TX_DMA_INTLVL;
+        #endif
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+void uart_flush(void){
+    #ifdef TXMODE_POLL
+        while(!(UART_DEV.STATUS & USART_DREIF_bm));
+    #endif
+    
+    #ifdef TXMODE_INTR
+        while(fifo_rdcount(&TXFIFO) != 0);
+        #ifdef RS485
+            // DE is released once the last character is shifted out
+            while(RS485_DE_PORT.OUT & DE_PIN_bm);
+        #endif
+    #endif
+    
+    #ifdef TXMODE_DMA
+        bool busy;
+        
+        #ifdef TX_COALESCE
+            // Send held data now
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                if (!(EDMA.TX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm)){
+                    tx_dma_start();
+                }
+            }
+        #endif
+        
+        // Wait until the last transfer completes and nothing else is waiting
+        do{
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                busy = (EDMA.TX_DMA_CH.CTRLA & EDMA_CH_ENABLE_bm) || (TX_transfer_len != 0);
+            }
+        }while(busy);
+        
+        // Wait until the last character is shifted out
+        #ifdef RS485
+            // The TXC interrupt clears TXCIF. It releases DE once the transmitter is idle.
+            while(RS485_DE_PORT.OUT & DE_PIN_bm);
+        #else
+            if(TX_txc_wait){
+                TX_txc_wait = false;
+                while(!(UART_DEV.STATUS & USART_TXCIF_bm));
+            }
+        #endif
+    #endif
+}
+
+//==================================================================================================
+//                                  Multi-Processor Communication
+//==================================================================================================
+void uart_set_address(int16_t address){
+    #ifdef MPCM
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            MPCM_address = address;
+            if(address < 0){
+                UART_DEV.CTRLB &= ~USART_MPCM_bm;
+            }else{
+                // Ignore data frames until the next address frame
+                UART_DEV.CTRLB |= USART_MPCM_bm;
+            }
+        }
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+void uart_send_address(uint8_t address){
+    #ifdef MPCM
+        // TXB8 applies to the next character loaded into DATA. Let all queued data frames go first.
+        uart_flush();
+        #ifdef RS485
+            rs485_begin();
+        #endif
+        while(!(UART_DEV.STATUS & USART_DREIF_bm));
+        
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            UART_DEV.CTRLB |= USART_TXB8_bm;
+        }
+        UART_DEV.DATA = address;
+        
+        // Once DATA is empty again, the address frame is in the shift register
+        while(!(UART_DEV.STATUS & USART_DREIF_bm));
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            UART_DEV.CTRLB &= ~USART_TXB8_bm;
+        }
+    #endif
+}
+
+//==================================================================================================
+//                                          Statistics
+//==================================================================================================
+void uart_get_stats(struct uart_stats *stats){
+    #ifdef UART_STATS
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            *stats = Stats;
+            #ifdef RXMODE_DMA
+                // Include the DMA block that is in progress
+                if(RX_async_active){
+                    stats->rx_bytes += (uint16_t)(RX_async_len - EDMA.RX_DMA_CH.TRFCNT);
+                }else{
+                    stats->rx_bytes += rx_dma_seg_written();
+                }
+            #endif
+        }
+    #else
+        memset(stats, 0, sizeof(struct uart_stats));
+    #endif
+}
+
+//--------------------------------------------------------------------------------------------------
+void uart_reset_stats(void){
+    #ifdef UART_STATS
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            memset(&Stats, 0, sizeof(Stats));
+            #ifdef RXMODE_DMA
+                // Bytes of the DMA block in progress were already counted
+                if(RX_async_active){
+                    Stats.rx_bytes -= (uint16_t)(RX_async_len - EDMA.RX_DMA_CH.TRFCNT);
+                }else{
+                    Stats.rx_bytes -= rx_dma_seg_written();
+                }
+            #endif
+        }
+    #endif
+}
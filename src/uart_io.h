@@ -13,6 +13,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 //==================================================================================================
 // Function Prototypes
@@ -20,6 +21,9 @@ extern "C" {
 
 /**
 * \brief Initializes the UART controller
+* \details In DMA mode, the EDMA controller is enabled but not reset, so channels used by other
+*   modules keep running. Its channel mode is set to 4 peripheral channels without double
+*   buffering. Other modules that use the EDMA must work with that mode.
 * \attention The initialization routine does \e not setup the IO ports!
 **/
 void uart_init(void);
@@ -29,6 +33,28 @@ void uart_init(void);
 **/
 void uart_uninit(void);
 
+/**
+* \brief Change the baud rate
+* \details Searches all BSEL, BSCALE and CLK2X combinations for the rate closest to the one requested.
+*   Any transfer in progress is corrupted.
+* \param rate Requested baud rate in Hz
+* \return The actual baud rate that was set. 0 if \c rate is out of range. (Nothing is changed)
+**/
+uint32_t uart_set_baud(uint32_t rate);
+
+/**
+* \brief Detect the baud rate from a sync character and switch to it
+* \details Waits for the sync character 0x55 ('U'). Other characters are skipped. Interrupts are
+*   disabled while the character is being measured. The RX pin is polled, so the measurement
+*   becomes coarse at baud rates approaching F_CPU/100.
+*
+*   Gives up if no edge arrives within 2 bit times at \c AUTOBAUD_MIN_RATE, so the line being quiet
+*   or stuck low doesn't block the caller. Call it again until it succeeds.
+* \note Requires \c UART_AUTOBAUD_EN
+* \return The actual baud rate that was set. 0 if it timed out. (Nothing is changed)
+**/
+uint32_t uart_autobaud(void);
+
 //==================================================================================================
 //                                          RX Functions
 //==================================================================================================
@@ -58,6 +84,157 @@ char uart_getc(void);
 **/
 void uart_read(void *buf, size_t size);
 
+/**
+* \brief Receive a block of data directly into a buffer
+*
+* The RX DMA channel is handed over to write the rest straight into \c buf, then the data that was
+* already in the RX buffer is copied to the front of \c buf. The RX buffer is used again once the
+* transfer completes. No other RX function may be used until then.
+*
+* \c callback is called from this function if all data arrived before it returns. Otherwise it runs
+* in interrupt context from the RX DMA interrupt, unless \c RX_ASYNC_EVENT_EN is set. It is then
+* pushed into the event queue instead, and uart_read_async_busy() stays true until it has run. If
+* the event queue is full, it is called from the interrupt.
+*
+* In interrupt and polling modes, this is the same as uart_read() followed by \c callback.
+*
+* \note Does not wait on any interrupt. May be called with interrupts disabled, from an interrupt,
+*   and from \c callback.
+* \param buf Destination buffer. Must remain allocated until the transfer completes.
+* \param size Number of bytes to be read. Sizes above 256 require an EDMA channel with a 16-bit
+*   transfer count.
+* \param callback Function to call once all data was received. NULL disables.
+* \return false if a previous transfer or its callback is still pending. Nothing is read then.
+**/
+bool uart_read_async(void *buf, size_t size, void (*callback)(void));
+
+/**
+* \brief Check if a uart_read_async() transfer is in progress
+* \return true if busy
+**/
+bool uart_read_async_busy(void);
+
+//==================================================================================================
+//                                          Line Discipline
+//==================================================================================================
+
+/**
+* \brief Read the next complete line that was received
+*
+* Lines are assembled in the RX buffer as characters arrive. Backspace (0x08 or 0x7F) removes the
+* last character of the line. CR, LF and CR+LF each end a line. The line is copied into \c buf
+* without the line ending and null-terminated, and its space in the RX buffer is freed. The line
+* may contain null characters, so use \c len rather than strlen().
+*
+* Characters that do not fit in the RX buffer are dropped. Received characters are not echoed.
+*
+* \note Requires \c UART_LINE_EN. The other RX functions must not be used to read the data.
+* \param buf Destination buffer. Lines longer than size-1 are truncated.
+* \param size Size of \c buf. Must be at least 1.
+* \param [out] len Number of characters copied, not including the null terminator
+* \return true if a line was available
+**/
+bool uart_line_get(char *buf, size_t size, size_t *len);
+
+//==================================================================================================
+//                                      RX Event Notifications
+//==================================================================================================
+
+/**
+ * \brief Public structure used to define when an RX event is posted
+ **/
+struct uart_rx_eventctl{
+    size_t threshold;       ///< Post when at least this many bytes are available. 0 disables
+    int16_t delimiter;      ///< Post when this character is received. -1 disables
+    uint16_t idle_ticks;    ///< Post when data is pending and the line was idle for this many RTC
+                            ///  ticks. 0 disables
+    void (*handler)(void);  ///< Event function to push into the event queue
+};
+
+/**
+* \brief Start posting RX events
+*
+* Once any of the conditions in \c settings is met, \c handler is pushed into the event queue. Only
+* one event is pending at a time. If the handler does not read all available data, the next
+* received byte may post the event again.
+*
+* In DMA mode, received data is inspected from an RTC timer every \c RX_EVENT_DMA_POLL_TICKS instead
+* of per byte. The idle time is rounded up to a multiple of that interval.
+*
+* If \c UART_LINE_EN is set, the event is posted whenever a line is completed instead of using
+* \c threshold and \c delimiter.
+*
+* \note Requires \c RX_EVENT_EN
+* \param settings Pointer to a \ref uart_rx_eventctl struct. Contents are copied.
+**/
+void uart_rx_event_start(const struct uart_rx_eventctl *settings);
+
+/**
+* \brief Stop posting RX events
+* \note An event that is already in the event queue is discarded.
+**/
+void uart_rx_event_stop(void);
+
+//==================================================================================================
+//                                  Multi-Processor Communication
+//==================================================================================================
+
+/**
+* \brief Set the address of this node on a multidrop bus
+* \details Data frames are ignored by the USART until an address frame matching \c address or
+*   \c UART_MPCM_BROADCAST is received. They are then received until the next address frame for
+*   another node. Address frames themselves are not placed in the RX buffer.
+* \note Requires \c UART_MPCM_EN
+* \param address Node address. -1 disables filtering so all data frames are received. (e.g. for
+*   the bus master)
+**/
+void uart_set_address(int16_t address);
+
+/**
+* \brief Send an address frame to select the node(s) that receive the following data
+* \details Blocks until all previously written data has been handed to the USART.
+* \note Requires \c UART_MPCM_EN
+* \param address Address of the node. \c UART_MPCM_BROADCAST selects all nodes.
+**/
+void uart_send_address(uint8_t address);
+
+//==================================================================================================
+//                                          Statistics
+//==================================================================================================
+
+/**
+ * \brief Snapshot of the UART traffic, error and buffer usage counters
+ **/
+struct uart_stats{
+    uint32_t rx_bytes;          ///< Bytes received. Includes bytes that were lost.
+    uint32_t tx_bytes;          ///< Bytes queued for transmission
+    uint16_t frame_errors;      ///< Characters received with a frame error (FERR)
+    uint16_t parity_errors;     ///< Characters received with a parity error (PERR)
+    uint16_t hw_overflows;      ///< USART receive buffer overflows (BUFOVF)
+    uint16_t rx_overruns;       ///< Number of times the RX buffer overran
+    uint32_t rx_bytes_lost;     ///< Bytes discarded due to RX buffer overruns
+    uint16_t cts_stalls;        ///< Number of times TX was stopped by CTS
+    uint32_t cts_blocked_ticks; ///< Time TX was stopped by CTS, in \c UART_STATS_TICKS() units
+    size_t rx_peak;             ///< Highest number of unread bytes in the RX buffer
+    size_t tx_peak;             ///< Highest number of bytes waiting in the TX buffer
+    uint16_t de_asserts;        ///< Number of RS-485 transmissions (DE asserted)
+    uint32_t de_ticks;          ///< Time DE was asserted, in \c UART_STATS_TICKS() units
+};
+
+/**
+* \brief Get a snapshot of the UART statistics
+* \details USART error flags can not be observed in RX DMA mode so their counters stay 0. In DMA
+*   mode, peak RX buffer usage is only sampled when data is read or a DMA block completes.
+* \note Requires \c UART_STATS_EN. Otherwise all counters are 0.
+* \param [out] stats Pointer to a \ref uart_stats struct to fill
+**/
+void uart_get_stats(struct uart_stats *stats);
+
+/**
+* \brief Reset all UART statistics to 0
+**/
+void uart_reset_stats(void);
+
 //==================================================================================================
 //                                          TX Functions
 //==================================================================================================
@@ -81,6 +258,36 @@ void uart_putc(const char c);
 **/
 void uart_puts(const char *s);
 
+/**
+* \brief Wait until all buffered TX data has been sent
+* \details Data held back by TX coalescing is sent immediately. In DMA mode and with RS-485, this
+*   also waits until the last character has been shifted out. Otherwise, the last character may
+*   still be shifting out when this returns.
+**/
+void uart_flush(void);
+
+/**
+* \brief Reserve space in the transmit buffer to write data into directly
+* \details Blocks until there is room. The reserved space is contiguous, so it may be smaller than
+*   the free space in the buffer if it wraps. Data written to it is sent once uart_tx_commit() is
+*   called. Only one reservation may be open at a time and no other TX function may be used until
+*   it is committed.
+*
+*   In polling mode, a small staging buffer is returned instead.
+* \param [out] ptr Pointer to the reserved space
+* \param max Maximum number of bytes to reserve
+* \return Number of bytes reserved. At least 1 if \c max is not 0.
+**/
+size_t uart_tx_reserve(char **ptr, size_t max);
+
+/**
+* \brief Send data that was written into the space from uart_tx_reserve()
+* \details With TX coalescing, this may start an RTC timer using timer_start(). That is safe in an
+*   ISR, but timer_start() may wait for the RTC to synchronize first.
+* \param len Number of bytes written. May be less than what was reserved.
+**/
+void uart_tx_commit(size_t len);
+
 
 #ifdef __cplusplus
 }
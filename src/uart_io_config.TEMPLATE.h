@@ -15,6 +15,7 @@
 #define UART_DEV        USARTD0
 #define UART_DEV_PORT   PORTD
 #define UART_TXPIN      PIN3_bm
+#define UART_RXPIN      PIN2_bm
 
 // Baud rate in Hz
 #define BAUD_RATE       9600L
@@ -22,10 +23,22 @@
 // CPU Clock in Hz
 #define F_CPU           2000000L
 
-// Buffer sizes. Max is 256 for DMA mode
+// Buffer sizes. Max is 32768 for DMA mode.
+// In DMA mode, sizes above 256 use 16-bit indexes and DMA transfer counts (TRFCNTH). The selected
+// EDMA channels must support 16-bit transfer counts.
 #define RX_BUF_SIZE     64
 #define TX_BUF_SIZE     64
 
+//==================================================================================================
+// Autobaud
+//==================================================================================================
+// If enabled, uart_autobaud() measures a sync character using the timer AUTOBAUD_TC
+#define UART_AUTOBAUD_EN    0
+#define AUTOBAUD_TC         TCC5
+
+// Lowest baud rate to detect. uart_autobaud() gives up after 2 bit times at this rate with no edge
+#define AUTOBAUD_MIN_RATE   1200L
+
 //==================================================================================================
 // TX Flow Control (Only supported if UART_TX_MODE == 1)
 //==================================================================================================
@@ -45,9 +58,111 @@
 // Interrupt vector for CTS pin's port
 #define TX_FLOW_PIN_VECTOR      PORTA_INT0_vect
 
+//==================================================================================================
+// RX Flow Control (Only supported if UART_RX_MODE == 1 or 2)
+//==================================================================================================
+// RTS output is driven high to request the sender to stop once the number of unread bytes reaches
+// RX_FLOW_HIGH. It is driven low again once the unread bytes drop to RX_FLOW_LOW.
+#define RX_FLOW_CONTROL_EN  0
+#define RX_FLOW_PORT        PORTA
+#define RX_FLOW_PIN         1
+
+// Watermarks in bytes
+#define RX_FLOW_HIGH        40
+#define RX_FLOW_LOW         16
+
+// DMA mode only: Number of DMA blocks that RX_BUF_SIZE is split into. Watermarks are checked at the
+// end of each block, so RX_FLOW_HIGH needs at least RX_BUF_SIZE/RX_FLOW_DMA_SEGMENTS bytes of
+// headroom, plus whatever the sender transmits before it reacts to RTS.
+#define RX_FLOW_DMA_SEGMENTS    4
+
+//==================================================================================================
+// RX Event Notifications (Only supported if UART_RX_MODE == 1 or 2)
+//==================================================================================================
+// Allows uart_rx_event_start() to post an event into the event queue when received data needs
+// attention. Requires the event_queue module, and the rtc module with RTC_TIMER_ENABLE.
+#define RX_EVENT_EN         0
+
+// In DMA mode, received data is only inspected from an RTC timer. This is the timer interval (in
+// RTC ticks). It is the latency of delimiter and threshold events, and the resolution of idle_ticks.
+#define RX_EVENT_DMA_POLL_TICKS 2
+
+//==================================================================================================
+// RS-485 Half-Duplex (Only supported if UART_RX_MODE and UART_TX_MODE are 1 or 2)
+//==================================================================================================
+// The driver enable (DE) output is driven high when transmission starts, and low from the transmit
+// complete interrupt once the last stop bit was sent and nothing else is queued. Characters
+// received while DE is high are our own transmission and are discarded. In RX DMA mode, this is
+// done by RX_ISR_VECTOR while DE is high.
+// DE goes low about 55 CPU cycles after the end of the stop bit (1.7us at 32 MHz), plus the time
+// any interrupt of the same or a higher level is running.
+#define RS485_EN            0
+#define RS485_DE_PORT       PORTD
+#define RS485_DE_PIN        1
+
+// Transmit complete interrupt
+#define TXC_ISR_VECTOR      USARTD0_TXC_vect
+#define TXC_ISR_INTLVL      USART_TXCINTLVL_HI_gc
+
+//==================================================================================================
+// Line Discipline (Only supported if UART_RX_MODE == 1)
+//==================================================================================================
+// Received characters are assembled into lines in place in the RX buffer, handling backspace and
+// CR/LF. Complete lines are read using uart_line_get(). RX_BUF_SIZE limits the line length. Each
+// line takes 2 bytes of the RX buffer on top of its characters.
+#define UART_LINE_EN        0
+
+//==================================================================================================
+// Multi-Processor Communication Mode (Only supported if UART_RX_MODE == 1)
+//==================================================================================================
+// Uses 9-bit frames for multidrop buses. Frames with the 9th bit set are addresses. Data frames sent
+// to other nodes are discarded by the USART without causing an RX interrupt.
+#define UART_MPCM_EN        0
+
+// Address of this node after uart_init(). Can be changed using uart_set_address()
+#define UART_MPCM_ADDRESS   0x01
+
+// Address that selects all nodes
+#define UART_MPCM_BROADCAST 0xFF
+
+//==================================================================================================
+// TX Coalescing (Only supported if UART_TX_MODE == 2)
+//==================================================================================================
+// Instead of starting a DMA transfer as soon as data is written, hold it until at least
+// TX_COALESCE_THRESHOLD bytes are waiting, or TX_COALESCE_TICKS RTC ticks have passed. Data written
+// while a transfer is in progress is always sent when it completes. uart_flush() sends held data
+// immediately. Requires the rtc module with RTC_TIMER_ENABLE.
+// Writing to the UART starts the timer if it isn't running. When that happens in an ISR, the ISR
+// also runs timer_start(), which may wait for the RTC to synchronize.
+#define TX_COALESCE_EN          0
+#define TX_COALESCE_THRESHOLD   16
+#define TX_COALESCE_TICKS       2
+
+//==================================================================================================
+// Async Read Completion (Only used if UART_RX_MODE == 2)
+//==================================================================================================
+// If enabled, the uart_read_async() callback is pushed into the event queue instead of being
+// called from the RX DMA interrupt. Requires the event_queue module.
+#define RX_ASYNC_EVENT_EN   0
+
+//==================================================================================================
+// Statistics
+//==================================================================================================
+// If enabled, traffic, error and buffer usage counters can be read using uart_get_stats()
+#define UART_STATS_EN       0
+
+// Free-running 16-bit timebase used to measure how long TX was blocked by CTS. (e.g. RTC.CNT or
+// the CNT register of a spare timer). Stalls longer than one timebase period are under-counted.
+// Set to 0 if not needed.
+#define UART_STATS_TICKS()  0
+
 //==================================================================================================
 // Interrupt mode configuration (If UART_XX_MODE == 1)
 //==================================================================================================
+// Without flow control, events, RS-485, MPCM or statistics, RX_ISR_VECTOR takes about 90 CPU cycles
+// per character and TX_ISR_VECTOR about 85, including interrupt entry and exit. These are counted
+// from XMEGA instruction timings, not measured. At 32 MHz and 8N1, the RX interrupt uses about 26%
+// of the CPU at 921600 baud and can keep up with at most about 3.5 Mbaud.
 #define RX_ISR_VECTOR   USARTD0_RXC_vect
 #define TX_ISR_VECTOR   USARTD0_DRE_vect
 
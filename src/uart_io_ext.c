@@ -23,67 +23,546 @@
 * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+
 #include <uart_io.h>
 #include <string_ext.h>
+#include "uart_io_ext.h"
+
+//==============================================================================
+// Output Stream
+//==============================================================================
+///\cond INTERNAL
+
+// Longest number string. (A Q16.16 such as "-32768.0000000000")
+#define NUM_LEN_MAX     17
+
+// Largest field that is formatted in one piece, including the null terminator
+#define FIELD_SIZE      24
+#define WIDTH_MAX       (FIELD_SIZE - 1)
+
+// Formatting flags
+#define FMT_LEFT        0x01    // Left-justify within the field width
+#define FMT_ZERO        0x02    // Pad with zeros instead of spaces
+#define FMT_TRIM        0x04    // Strip leading zeros (hex)
+
+// Number types
+enum{
+    NUM_X8, NUM_X16, NUM_X32,
+    NUM_D8, NUM_D16, NUM_D32,
+    NUM_SD8, NUM_SD16, NUM_SD32,
+    NUM_Q8_8, NUM_Q16_16
+};
+
+// Span of the TX buffer that is currently reserved
+static struct{
+    char *span;
+    size_t size;
+    size_t used;
+} Out;
+
+static void out_begin(void){
+    Out.size = uart_tx_reserve(&Out.span, SIZE_MAX);
+    Out.used = 0;
+}
+
+//------------------------------------------------------------------------------
+static void out_end(void){
+    uart_tx_commit(Out.used);
+}
+
+//------------------------------------------------------------------------------
+static void out_putc(char c){
+    if(Out.used == Out.size){
+        out_end();
+        out_begin();
+    }
+    Out.span[Out.used++] = c;
+}
+
+//------------------------------------------------------------------------------
+/**
+* \brief Copy characters into the TX buffer, in as many pieces as the reserved spans need
+**/
+static void out_write(const char *str, size_t len){
+    size_t n;
+    
+    while(len){
+        if(Out.used == Out.size){
+            out_end();
+            out_begin();
+        }
+        n = Out.size - Out.used;
+        if(n > len) n = len;
+        memcpy(Out.span + Out.used, str, n);
+        Out.used += n;
+        str += n;
+        len -= n;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+* \brief Get space for a field directly in the TX buffer
+* \param size Number of bytes needed
+* \return Pointer to the space, or NULL if the reserved span can't fit it.
+**/
+static char *out_field(size_t size){
+    if((Out.size - Out.used) < size){
+        out_end();
+        out_begin();
+        if(Out.size < size){
+            // Span is cut short by the end of the buffer
+            return(NULL);
+        }
+    }
+    return(Out.span + Out.used);
+}
+
+//==============================================================================
+// Field Formatting
+//==============================================================================
+/**
+* \brief Format a number into buf and apply the field width
+* \param [out] buf Destination. Must hold FIELD_SIZE characters
+* \return Number of characters written, not including the null terminator
+**/
+static uint8_t fmt_num(char *buf, uint8_t type, uint32_t num, uint8_t width, uint8_t prec,
+                       uint8_t flags){
+    uint8_t n;
+    uint8_t k;
+    
+    switch(type){
+        case NUM_X8:    n = snprint_x8(buf, FIELD_SIZE, num); break;
+        case NUM_X16:   n = snprint_x16(buf, FIELD_SIZE, num); break;
+        case NUM_X32:   n = snprint_x32(buf, FIELD_SIZE, num); break;
+        case NUM_D8:    n = snprint_d8(buf, FIELD_SIZE, num); break;
+        case NUM_D16:   n = snprint_d16(buf, FIELD_SIZE, num); break;
+        case NUM_D32:   n = snprint_d32(buf, FIELD_SIZE, num); break;
+        case NUM_SD8:   n = snprint_sd8(buf, FIELD_SIZE, num); break;
+        case NUM_SD16:  n = snprint_sd16(buf, FIELD_SIZE, num); break;
+        case NUM_SD32:  n = snprint_sd32(buf, FIELD_SIZE, num); break;
+        case NUM_Q8_8:  n = snprint_sq16(buf, FIELD_SIZE, num, 8, prec); break;
+        default:        n = snprint_sq32(buf, FIELD_SIZE, num, 16, prec); break;
+    }
+    
+    if(flags & FMT_TRIM){
+        k = 0;
+        while((k < n-1) && (buf[k] == '0')) k++;
+        if(k){
+            n -= k;
+            memmove(buf, buf + k, n);
+        }
+    }
+    
+    if(n < width){
+        k = width - n;
+        if(flags & FMT_LEFT){
+            memset(buf + n, ' ', k);
+        }else if(flags & FMT_ZERO){
+            // Zeros go after the sign
+            uint8_t s = (buf[0] == '-') ? 1 : 0;
+            memmove(buf + s + k, buf + s, n - s);
+            memset(buf + s, '0', k);
+        }else{
+            memmove(buf + k, buf, n);
+            memset(buf, ' ', k);
+        }
+        n = width;
+    }
+    
+    return(n);
+}
+
+//------------------------------------------------------------------------------
+/**
+* \brief Output a number. Formats directly into the TX buffer if possible.
+**/
+static void out_num(uint8_t type, uint32_t num, uint8_t width, uint8_t prec, uint8_t flags){
+    char tmp[FIELD_SIZE];
+    char *field;
+    uint8_t n;
+    uint8_t i;
+    
+    field = out_field(((width > NUM_LEN_MAX) ? width : NUM_LEN_MAX) + 1);
+    if(field){
+        Out.used += fmt_num(field, type, num, width, prec, flags);
+    }else{
+        n = fmt_num(tmp, type, num, width, prec, flags);
+        for(i=0; i<n; i++){
+            out_putc(tmp[i]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+* \brief Output a fixed-point number. Formats directly into the TX buffer if possible.
+* \param is_signed If true, num is an int32_t
+**/
+static void out_q(uint32_t num, bool is_signed, uint8_t fbits, uint8_t digits){
+    char tmp[FIELD_SIZE];
+    char *field;
+    uint8_t n;
+    uint8_t i;
+    
+    field = out_field(FIELD_SIZE);
+    if(field == NULL) field = tmp;
+    
+    if(is_signed){
+        n = snprint_sq32(field, FIELD_SIZE, num, fbits, digits);
+    }else{
+        n = snprint_q32(field, FIELD_SIZE, num, fbits, digits);
+    }
+    
+    if(field == tmp){
+        for(i=0; i<n; i++){
+            out_putc(tmp[i]);
+        }
+    }else{
+        Out.used += n;
+    }
+}
+
+///\endcond
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+void uart_printf(const char *fmt, ...){
+    va_list ap;
+    uint8_t flags;
+    uint8_t width;
+    uint8_t prec;
+    uint8_t type;
+    uint32_t num;
+    bool is_long;
+    const char *s;
+    size_t len;
+    
+    va_start(ap, fmt);
+    out_begin();
+    
+    while(*fmt){
+        if(*fmt != '%'){
+            out_putc(*fmt++);
+            continue;
+        }
+        fmt++;
+        
+        // Flags
+        flags = 0;
+        while(1){
+            if(*fmt == '-'){
+                flags |= FMT_LEFT;
+            }else if(*fmt == '0'){
+                flags |= FMT_ZERO;
+            }else{
+                break;
+            }
+            fmt++;
+        }
+        
+        // Width
+        width = 0;
+        while((*fmt >= '0') && (*fmt <= '9')){
+            width = width*10 + (*fmt++ - '0');
+        }
+        if(width > WIDTH_MAX) width = WIDTH_MAX;
+        
+        // Precision. Only used by %q
+        prec = 2;
+        if(*fmt == '.'){
+            fmt++;
+            prec = 0;
+            while((*fmt >= '0') && (*fmt <= '9')){
+                prec = prec*10 + (*fmt++ - '0');
+            }
+            if(prec > 10) prec = 10;
+        }
+        
+        // Length
+        is_long = false;
+        if(*fmt == 'l'){
+            is_long = true;
+            fmt++;
+        }
+        
+        switch(*fmt){
+            case 'd':
+            case 'i':
+                if(is_long){
+                    type = NUM_SD32;
+                    num = va_arg(ap, long);
+                }else{
+                    type = NUM_SD16;
+                    num = (int16_t)va_arg(ap, int);
+                }
+                out_num(type, num, width, prec, flags);
+                break;
+            case 'u':
+                if(is_long){
+                    type = NUM_D32;
+                    num = va_arg(ap, unsigned long);
+                }else{
+                    type = NUM_D16;
+                    num = (uint16_t)va_arg(ap, unsigned int);
+                }
+                out_num(type, num, width, prec, flags);
+                break;
+            case 'x':
+            case 'X':
+                if(is_long){
+                    type = NUM_X32;
+                    num = va_arg(ap, unsigned long);
+                }else{
+                    type = NUM_X16;
+                    num = (uint16_t)va_arg(ap, unsigned int);
+                }
+                out_num(type, num, width, prec, flags | FMT_TRIM);
+                break;
+            case 'q':
+                if(is_long){
+                    type = NUM_Q16_16;
+                    num = va_arg(ap, long);
+                }else{
+                    type = NUM_Q8_8;
+                    num = (int16_t)va_arg(ap, int);
+                }
+                out_num(type, num, width, prec, flags);
+                break;
+            case 'c':
+                out_putc(va_arg(ap, int));
+                break;
+            case 's':
+                s = va_arg(ap, const char *);
+                len = 0;
+                if(width){
+                    len = strlen(s);
+                    if(!(flags & FMT_LEFT)){
+                        while(len < width){
+                            out_putc(' ');
+                            width--;
+                        }
+                    }
+                }
+                while(*s){
+                    out_putc(*s++);
+                }
+                while(len < width){
+                    out_putc(' ');
+                    width--;
+                }
+                break;
+            case '%':
+                out_putc('%');
+                break;
+            case 0:
+                // Format string ended early
+                fmt--;
+                break;
+            default:
+                // Unknown conversion. Print it as-is.
+                out_putc('%');
+                out_putc(*fmt);
+                break;
+        }
+        fmt++;
+    }
+    
+    out_end();
+    va_end(ap);
+}
 
+//------------------------------------------------------------------------------
 void uart_put_x8(uint8_t num){
-    char buf[3];
-    snprint_x8(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_X8, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_x16(uint16_t num){
-    char buf[5];
-    snprint_x16(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_X16, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_x32(uint32_t num){
-    char buf[9];
-    snprint_x32(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_X32, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_d8(uint8_t num){
-    char buf[4];
-    snprint_d8(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_D8, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_d16(uint16_t num){
-    char buf[6];
-    snprint_d16(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_D16, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_d32(uint32_t num){
-    char buf[11];
-    snprint_d32(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_D32, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_sd8(int8_t num){
-    char buf[5];
-    snprint_sd8(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_SD8, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_sd16(int16_t num){
-    char buf[7];
-    snprint_sd16(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_SD16, num, 0, 0, 0);
+    out_end();
 }
 
 //------------------------------------------------------------------------------
 void uart_put_sd32(int32_t num){
-    char buf[12];
-    snprint_sd32(buf, sizeof(buf), num);
-    uart_puts(buf);
+    out_begin();
+    out_num(NUM_SD32, num, 0, 0, 0);
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_put_q8(uint8_t num, uint8_t fbits, uint8_t digits){
+    out_begin();
+    out_q(num, false, fbits, digits);
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_put_q16(uint16_t num, uint8_t fbits, uint8_t digits){
+    out_begin();
+    out_q(num, false, fbits, digits);
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_put_q32(uint32_t num, uint8_t fbits, uint8_t digits){
+    out_begin();
+    out_q(num, false, fbits, digits);
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_put_sq8(int8_t num, uint8_t fbits, uint8_t digits){
+    out_begin();
+    out_q(num, true, fbits, digits);
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_put_sq16(int16_t num, uint8_t fbits, uint8_t digits){
+    out_begin();
+    out_q(num, true, fbits, digits);
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_put_sq32(int32_t num, uint8_t fbits, uint8_t digits){
+    out_begin();
+    out_q(num, true, fbits, digits);
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_put_row(const struct row_field *fields, uint8_t count, uint8_t format, char sep){
+    char tmp[ROW_FIELD_LEN_MAX+1];
+    char *field;
+    uint8_t n;
+    
+    out_begin();
+    while(count){
+        field = out_field(ROW_FIELD_LEN_MAX+1);
+        if(field){
+            Out.used += snprint_field(field, ROW_FIELD_LEN_MAX+1, fields, format);
+        }else{
+            n = snprint_field(tmp, sizeof(tmp), fields, format);
+            out_write(tmp, n);
+        }
+        fields++;
+        count--;
+        
+        if(sep && count){
+            out_putc(sep);
+        }
+    }
+    out_putc('\r');
+    out_putc('\n');
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void uart_hexdump(uint32_t addr, uint32_t len, hexdump_read_t read){
+    uint8_t data[HEXDUMP_ROW_BYTES];
+    char tmp[HEXDUMP_ROW_LEN_MAX+3];
+    char *field;
+    uint8_t n;
+    uint8_t k;
+    
+    out_begin();
+    while(len){
+        n = (len > HEXDUMP_ROW_BYTES) ? HEXDUMP_ROW_BYTES : len;
+        read(data, addr, n);
+        
+        field = out_field(HEXDUMP_ROW_LEN_MAX+1);
+        if(field){
+            Out.used += snprint_hexdump(field, HEXDUMP_ROW_LEN_MAX+1, addr, data, n);
+            out_putc('\r');
+            out_putc('\n');
+        }else{
+            // A row is longer than what a small TX buffer can reserve in one piece. Format it
+            // aside and copy it in as many pieces as needed.
+            k = snprint_hexdump(tmp, HEXDUMP_ROW_LEN_MAX+1, addr, data, n);
+            tmp[k++] = '\r';
+            tmp[k++] = '\n';
+            out_write(tmp, k);
+        }
+        
+        addr += n;
+        len -= n;
+    }
+    out_end();
+}
+
+//------------------------------------------------------------------------------
+void hexdump_read_ram(void *dst, uint32_t addr, uint8_t len){
+    memcpy(dst, (const void*)(uintptr_t)addr, len);
+}
+
+//------------------------------------------------------------------------------
+void hexdump_read_flash(void *dst, uint32_t addr, uint8_t len){
+    #if(FLASHEND > 0xFFFF)
+        // ELPM. Reaches above 64K
+        memcpy_PF(dst, addr, len);
+    #else
+        memcpy_P(dst, (const void*)(uintptr_t)addr, len);
+    #endif
+}
+
+//------------------------------------------------------------------------------
+void hexdump_read_eeprom(void *dst, uint32_t addr, uint8_t len){
+    eeprom_read_block(dst, (const void*)(uintptr_t)addr, len);
 }
@@ -28,6 +28,24 @@
 
 #include <stdint.h>
 
+#include <string_ext.h>
+
+/**
+* \brief Formatted output to the UART
+* \details A small replacement for printf() that formats directly into the UART's transmit buffer.
+*   Supported conversions:
+*   - \c %d \c %i \c %u \c %x \c %X : 16-bit integers. 32-bit with the \c l modifier (\c %ld)
+*   - \c %q : Signed Q8.8 fixed-point in an \c int16_t. Q16.16 in an \c int32_t with \c %lq.
+*     Precision sets the number of fractional digits (0 to 10, default 2). eg: \c %.3lq
+*     The last digit is rounded to nearest, halves away from zero.
+*   - \c %c \c %s \c %%
+*
+*   Flags \c - (left-justify) and \c 0 (zero-pad), and a field width of up to 23 are supported.
+*   Hex digits are always uppercase.
+* \param fmt Format string
+**/
+void uart_printf(const char *fmt, ...);
+
 void uart_put_x8(uint8_t num);
 void uart_put_x16(uint16_t num);
 void uart_put_x32(uint32_t num);
@@ -38,4 +56,56 @@ void uart_put_sd8(int8_t num);
 void uart_put_sd16(int16_t num);
 void uart_put_sd32(int32_t num);
 
+/**
+* \brief Write a fixed-point number to the UART
+* \details Formatted the same way as snprint_q32() and snprint_sq32()
+* \param num Fixed-point number
+* \param fbits Number of fractional bits in \c num
+* \param digits Number of digits after the decimal point (0 to 10)
+**/
+void uart_put_q8(uint8_t num, uint8_t fbits, uint8_t digits);
+void uart_put_q16(uint16_t num, uint8_t fbits, uint8_t digits);
+void uart_put_q32(uint32_t num, uint8_t fbits, uint8_t digits);
+void uart_put_sq8(int8_t num, uint8_t fbits, uint8_t digits);
+void uart_put_sq16(int16_t num, uint8_t fbits, uint8_t digits);
+void uart_put_sq32(int32_t num, uint8_t fbits, uint8_t digits);
+
+/**
+* \brief Write a row of fields to the UART, followed by "\r\n"
+* \details Fields are formatted the same way as snprint_row(), directly into the transmit buffer.
+*   eg: A CSV line of telemetry values
+* \param fields Array of fields
+* \param count Number of fields
+* \param format Number format. (\ref row_format)
+* \param sep Separator between fields. 0 for none.
+**/
+void uart_put_row(const struct row_field *fields, uint8_t count, uint8_t format, char sep);
+
+/**
+* \brief Function that reads data to be hex dumped
+* \param [out] dst Destination of the data
+* \param addr Address to read from
+* \param len Number of bytes to read (1 to 16)
+**/
+typedef void (*hexdump_read_t)(void *dst, uint32_t addr, uint8_t len);
+
+/**
+* \brief Write a hex dump of memory to the UART
+* \details Each row of 16 bytes is formatted as described in snprint_hexdump(), directly into the
+*   transmit buffer, and ends with "\r\n".
+* \param addr Address of the first byte
+* \param len Number of bytes to dump
+* \param read Function that reads the memory. eg: hexdump_read_flash
+**/
+void uart_hexdump(uint32_t addr, uint32_t len, hexdump_read_t read);
+
+/// Reads data memory for uart_hexdump()
+void hexdump_read_ram(void *dst, uint32_t addr, uint8_t len);
+
+/// Reads program memory for uart_hexdump(). Uses ELPM on devices with more than 64K of flash.
+void hexdump_read_flash(void *dst, uint32_t addr, uint8_t len);
+
+/// Reads EEPROM for uart_hexdump()
+void hexdump_read_eeprom(void *dst, uint32_t addr, uint8_t len);
+
 #endif